@@ -9,18 +9,27 @@
 #include <boost/beast/version.hpp>
 #include <boost/config.hpp>
 #include <boost/stacktrace.hpp>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <nlohmann/json.hpp>
 #include <random>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "settings/app.hpp"
 #include "types/app.hpp"
 #include "utils/Logger.hpp"
 #include "utils/common.hpp"
+#include "utils/compression.hpp"
+#include "utils/storage.hpp"
+#include "utils/streaming_stats.hpp"
+#include "utils/tracing.hpp"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -29,25 +38,380 @@ namespace fs = std::filesystem;
 using tcp = net::ip::tcp;
 using json = nlohmann::json;
 
-class ExitHandler
+static std::unique_ptr<storage::Backend> case_storage; // selected with --storage <backend>, detached at exit
+static Tracer tracer; // enabled with --trace <file>
+static compression::Options zstd_options; // used when case_codec is "zstd"
+
+static inline std::string to_lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+// Per-sweep aggregates of the numeric values found in case outputs.
+struct SweepAggregate
+{
+    struct Column
+    {
+        RunningStats stats;
+        StreamingQuantile p50{0.50};
+        StreamingQuantile p90{0.90};
+        StreamingQuantile p99{0.99};
+
+        void add(double x)
+        {
+            stats.add(x);
+            p50.add(x);
+            p90.add(x);
+            p99.add(x);
+        }
+    };
+
+    std::string simulator;
+    std::string version;
+    std::string dag_id; // set instead of simulator and version for the nodes of one DAG
+    std::size_t expected = 0;
+    std::size_t succeeded = 0;
+    std::size_t failed = 0;     // simulator reported failure
+    std::size_t unreadable = 0; // output missing or not parsable
+    std::size_t rejected = 0;   // refused by the platform, so no result will come
+    std::map<std::string, Column> columns;
+    std::unordered_set<std::string> folded; // case ids already counted; callbacks may be delivered twice
+    bool completed = false;
+
+    std::size_t received() const { return succeeded + failed + unreadable + rejected; }
+};
+
+// Completed SimulationResults are queued here. Their output files are read and parsed on an I/O
+// pool, and the values are folded into per-sweep aggregates on a single strand, so no locking is
+// needed. Once every expected case of a sweep has arrived, a columnar summary is written next to
+// the case directories.
+class ResultPipeline
 {
 public:
-    ~ExitHandler()
+    explicit ResultPipeline(std::size_t io_threads) : pool_(io_threads), strand_(net::make_strand(pool_)) {}
+
+    ~ResultPipeline()
+    {
+        pool_.join();
+    }
+
+    // Register a sweep before submitting its cases, so that its completion can be detected.
+    void expect(const std::string &simulator, const std::string &version, std::size_t num_cases)
+    {
+        net::post(strand_, [this, simulator, version, num_cases]
+        {
+            auto &agg = sweeps_[sweep_key(simulator, version)];
+            agg.simulator = simulator;
+            agg.version = version;
+            agg.expected += num_cases;
+            agg.completed = false;
+            maybe_complete(agg);
+        });
+    }
+
+    // A case of the sweep that the platform refused for good; it counts as received, so that the
+    // sweep still completes.
+    void reject(const std::string &simulator, const std::string &version, const std::string &case_id)
+    {
+        net::post(strand_, [this, simulator, version, case_id]
+        {
+            auto &agg = sweeps_[sweep_key(simulator, version)];
+            if (!agg.folded.insert(case_id).second)
+                return;
+            ++agg.rejected;
+            maybe_complete(agg);
+        });
+    }
+
+    // The nodes of a DAG are folded into an aggregate of their own, keyed by dag_id, that completes
+    // once every node is in; skipped nodes count as failed. They never join the sweeps of the same
+    // simulator/version, which only expect the cases this app submitted.
+    void submit(const DagResult &dag)
+    {
+        net::post(strand_, [this, dag_id = dag.dag_id, nodes = dag.cases.size()]
+        {
+            auto &agg = sweeps_[dag_key(dag_id)];
+            if (!agg.dag_id.empty())
+                return; // delivered again
+            agg.dag_id = dag_id;
+            agg.expected = nodes;
+        });
+        for (auto &node : dag.cases)
+        {
+            SimulationResult result;
+            result.simulator = node.simulator;
+            result.version = node.version;
+            result.app_id = dag.app_id;
+            result.case_id = node.case_id;
+            result.outputfile = node.outputfile;
+            result.success = node.status == "completed";
+            result.trace_id = dag.trace_id;
+            ingest(dag_key(dag.dag_id), std::move(result));
+        }
+    }
+
+    void submit(SimulationResult result)
+    {
+        std::string key = sweep_key(result.simulator, result.version);
+        ingest(std::move(key), std::move(result));
+    }
+
+private:
+    net::thread_pool pool_;
+    net::strand<net::thread_pool::executor_type> strand_;
+    std::map<std::string, SweepAggregate> sweeps_; // only touched on strand_
+
+    static std::string sweep_key(const std::string &simulator, const std::string &version)
+    {
+        return simulator + "/" + version;
+    }
+
+    static std::string dag_key(const std::string &dag_id)
+    {
+        return "dag:" + dag_id;
+    }
+
+    // Reads the result's output on the pool and folds it into the aggregate at key.
+    void ingest(std::string key, SimulationResult result)
+    {
+        auto start_us = Tracer::now_us();
+        net::post(pool_, [this, key = std::move(key), result = std::move(result), start_us]() mutable
+        {
+            std::vector<std::pair<std::string, double>> values;
+            bool readable = result.success && read_output(result, values);
+            net::post(strand_, [this, key = std::move(key), result = std::move(result), values = std::move(values), readable, start_us]
+            {
+                fold(key, result, values, readable);
+                tracer.span("ingest", result.trace_id, start_us, Tracer::now_us());
+            });
+        });
+    }
+
+    static void flatten(const json &j, const std::string &prefix, std::vector<std::pair<std::string, double>> &out)
+    {
+        if (j.is_number())
+        {
+            out.emplace_back(prefix.empty() ? "value" : prefix, j.get<double>());
+        }
+        else if (j.is_object())
+        {
+            for (auto &[key, value] : j.items())
+                flatten(value, prefix.empty() ? key : prefix + "." + key, out);
+        }
+        else if (j.is_array())
+        {
+            for (std::size_t i = 0; i < j.size(); ++i)
+                flatten(j[i], prefix + "[" + std::to_string(i) + "]", out);
+        }
+    }
+
+    // JSON outputs contribute one column per numeric leaf; anything else is treated as
+    // whitespace-separated numbers named v0, v1, ...
+    static bool read_output(const SimulationResult &result, std::vector<std::pair<std::string, double>> &values)
+    {
+        fs::path path = abs_output_file_path(result.simulator, result.version, result.case_id, result.outputfile);
+        std::string decompressed;
+        std::optional<storage::Blob> blob;
+        std::string_view content;
+        if (result.codec == compression::zstd_codec)
+        {
+            try
+            {
+                decompressed = compression::decompress(path, zstd_options.dictionary);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Unable to read output file: {}", e.what());
+                return false;
+            }
+            content = decompressed;
+        }
+        else
+        {
+            blob = case_storage->get(path);
+            if (!blob)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Unable to open output file: {}", path.string());
+                return false;
+            }
+            content = blob->view();
+        }
+
+        auto first = content.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && (content[first] == '{' || content[first] == '['))
+        {
+            try
+            {
+                flatten(json::parse(content), "", values);
+                return true;
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Parse JSON failed: {} -> {}", path.string(), e.what());
+                return false;
+            }
+        }
+
+        std::string token;
+        for (std::size_t pos = content.find_first_not_of(" \t\r\n\f\v"); pos != std::string_view::npos;)
+        {
+            std::size_t end_pos = std::min(content.find_first_of(" \t\r\n\f\v", pos), content.size());
+            token.assign(content.substr(pos, end_pos - pos));
+            pos = content.find_first_not_of(" \t\r\n\f\v", end_pos);
+            char *end = nullptr;
+            double v = std::strtod(token.c_str(), &end);
+            if (end != token.c_str() && *end == '\0')
+                values.emplace_back("v" + std::to_string(values.size()), v);
+        }
+        return true;
+    }
+
+    void fold(const std::string &key, const SimulationResult &result,
+              const std::vector<std::pair<std::string, double>> &values, bool readable)
+    {
+        auto &agg = sweeps_[key];
+        if (agg.dag_id.empty())
+        {
+            agg.simulator = result.simulator;
+            agg.version = result.version;
+        }
+        if (!agg.folded.insert(result.case_id).second)
+        {
+            SPDLOG_LOGGER_WARN(Logger::instance(), "Ignore duplicate result of case {}", result.case_id);
+            return;
+        }
+        if (!result.success)
+            ++agg.failed;
+        else if (!readable)
+            ++agg.unreadable;
+        else
+        {
+            ++agg.succeeded;
+            for (auto &[name, v] : values)
+                agg.columns[name].add(v);
+        }
+        SPDLOG_LOGGER_DEBUG(Logger::instance(), "Sweep {}: {}/{} results", key, agg.received(), agg.expected);
+        maybe_complete(agg);
+    }
+
+    void maybe_complete(SweepAggregate &agg)
+    {
+        if (agg.completed || agg.expected == 0 || agg.received() < agg.expected)
+            return;
+        agg.completed = true;
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Sweep {} completed: {} succeeded, {} failed, {} unreadable, {} rejected",
+                           agg.dag_id.empty() ? sweep_key(agg.simulator, agg.version) : dag_key(agg.dag_id),
+                           agg.succeeded, agg.failed, agg.unreadable, agg.rejected);
+        write_summary(agg);
+    }
+
+    // One array per statistic, indexed by column; NaN (no samples) is written as null.
+    static void write_summary(const SweepAggregate &agg)
     {
-        safe_system(unmount_nfs_command());
+        json name = json::array(), count = json::array(), min = json::array(), max = json::array(),
+             mean = json::array(), p50 = json::array(), p90 = json::array(), p99 = json::array();
+        for (auto &[column, c] : agg.columns)
+        {
+            name.push_back(column);
+            count.push_back(c.stats.count());
+            min.push_back(c.stats.min());
+            max.push_back(c.stats.max());
+            mean.push_back(c.stats.mean());
+            p50.push_back(c.p50.value());
+            p90.push_back(c.p90.value());
+            p99.push_back(c.p99.value());
+        }
+        json summary = {
+            {"cases"     , agg.expected},
+            {"succeeded" , agg.succeeded},
+            {"failed"    , agg.failed},
+            {"unreadable", agg.unreadable},
+            {"rejected"  , agg.rejected},
+            {"columns"   , {{"name", name}, {"count", count}, {"min", min}, {"max", max},
+                            {"mean", mean}, {"p50", p50}, {"p90", p90}, {"p99", p99}}},
+        };
+
+        if (agg.dag_id.empty())
+        {
+            summary["simulator"] = agg.simulator;
+            summary["version"] = agg.version;
+        }
+        else
+            summary["dag_id"] = agg.dag_id;
+
+        // Write to a temporary file first so readers never see a partial summary.
+        fs::path path = agg.dag_id.empty() ? sweep_summary_path(agg.simulator, agg.version) : dag_summary_path(agg.dag_id);
+        try
+        {
+            case_storage->put(path, summary.dump() + '\n');
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to publish summary: {}", e.what());
+            return;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Write summary {}", path.string());
     }
 };
 
-static ExitHandler handler;
+// Additive-increase / multiplicative-decrease pacing of case submissions: the rate grows by a
+// constant while cases are accepted and is cut by a factor whenever the platform reports overload,
+// so that overload turns into controlled queueing on our side.
+class SubmitRateController
+{
+public:
+    using clock = std::chrono::steady_clock;
 
-static inline std::string to_lower(std::string s)
+    // Block until the next case may be sent.
+    void wait()
+    {
+        std::this_thread::sleep_until(next_);
+        next_ = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate_));
+    }
+
+    void on_accepted()
+    {
+        rate_ = std::min(submit_max_rate, rate_ + submit_rate_increase);
+    }
+
+    void on_overload(std::chrono::milliseconds retry_after)
+    {
+        rate_ = std::max(submit_min_rate, rate_ * submit_rate_decrease);
+        next_ = std::max(next_, clock::now() + retry_after);
+    }
+
+    double rate() const { return rate_; }
+
+private:
+    double rate_ = submit_initial_rate;
+    clock::time_point next_ = clock::now();
+};
+
+static bool is_overload(http::status status)
 {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
-    return s;
+    return status == http::status::too_many_requests || status == http::status::service_unavailable ||
+           status == http::status::bad_gateway;
 }
 
+// Retry-After in seconds as sent by the platform; 1s when absent or malformed.
+static std::chrono::milliseconds retry_after_of(const http::response<http::string_body> &res)
+{
+    auto it = res.find(http::field::retry_after);
+    if (it != res.end())
+    {
+        try
+        {
+            return std::chrono::seconds(std::stoul(std::string(it->value())));
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    return std::chrono::seconds(1);
+}
 
-void post_requests(const int num_cases, net::io_context &ioc)
+void post_requests(const int num_cases, net::io_context &ioc, ResultPipeline &pipeline)
 {
     // TODO
     const std::string& template_path = "simple_sim_input.txt";
@@ -107,12 +471,19 @@ void post_requests(const int num_cases, net::io_context &ioc)
         return;
     }
 
+    pipeline.expect(simulator, version, num_cases);
+    SubmitRateController rate;
+
     for (int i = 1; i <= num_cases; ++i)
     {
         std::string case_id = "case" + std::to_string(i);
+        std::string trace_id = Tracer::new_trace_id();
+        auto write_start_us = Tracer::now_us();
 
         // Where each case’s input file should go
-        fs::path input_file_path = abs_input_file_path(simulator, version, case_id, input_filename);
+        const bool compressed = case_codec == compression::zstd_codec;
+        const std::string input_name = compressed ? input_filename.string() + compression::zstd_extension : input_filename.string();
+        fs::path input_file_path = abs_input_file_path(simulator, version, case_id, input_name);
 
         // Ensure directory exists
         std::error_code fec;
@@ -124,69 +495,118 @@ void post_requests(const int num_cases, net::io_context &ioc)
         }
 
         // Write per-case input file
+        if (compressed)
         {
-            std::ofstream out(input_file_path, std::ios::binary | std::ios::trunc);
-            if (!out) {
-                SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to write: {}", input_file_path.string());
+            try
+            {
+                compression::compress(is_json ? json_template.dump(2) + '\n' : text_template, input_file_path, zstd_options);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to write: {}", e.what());
                 return;
             }
-            if (is_json) {
-                // If you need to customize JSON per case, modify json_template here
-                out << json_template.dump(2) << '\n';
-            } else {
-                out << text_template; // raw text for .txt (e.g., "10 20")
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Generate {}", input_file_path.string());
+        }
+        else
+        {
+            try
+            {
+                // If you need to customize JSON per case, modify json_template here; .txt inputs are
+                // raw text (e.g., "10 20")
+                case_storage->put(input_file_path, is_json ? json_template.dump(2) + '\n' : text_template);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "{}", e.what());
+                return;
             }
-            out.close();
             SPDLOG_LOGGER_INFO(Logger::instance(), "Generate {}", input_file_path.string());
         }
+        tracer.span("write_input", trace_id, write_start_us, Tracer::now_us());
 
         // Build HTTP request to the request manager
         http::request<http::string_body> req{http::verb::post, request_manager_target_for_app, 11};
         req.set(http::field::host, request_manager_ip);
         req.keep_alive(true);
         req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-        req.set(http::field::content_type, "application/json");
 
         // Body: SimulationRequest {simulator, version, app_id, case_id, input_filename}
-        json body_json = SimulationRequest{simulator, version, app_id, case_id, input_filename};
-        req.body() = body_json.dump();
+        SimulationRequest sim_req{simulator, version, app_id, case_id, input_name, trace_id, case_codec, case_affinity};
+        if (use_wire_protocol)
+        {
+            req.set(http::field::content_type, wire_content_type);
+            to_wire(req.body(), sim_req);
+        }
+        else
+        {
+            req.set(http::field::content_type, json_content_type);
+            req.body() = json(sim_req).dump();
+        }
         req.prepare_payload();
 
-        // Send
-        http::write(stream, req);
-        SPDLOG_LOGGER_INFO(Logger::instance(), "{} to {}", std::string(req.method_string()), request_manager_target_for_app);
-        SPDLOG_LOGGER_INFO(Logger::instance(), "body = {}", req.body());
+        // Send, backing off while the platform reports overload
+        for (;;)
+        {
+            rate.wait();
+            auto submit_start_us = Tracer::now_us();
+            http::write(stream, req);
+            SPDLOG_LOGGER_INFO(Logger::instance(), "{} to {}", std::string(req.method_string()), request_manager_target_for_app);
+            if (!use_wire_protocol)
+                SPDLOG_LOGGER_INFO(Logger::instance(), "body = {}", req.body());
+
+            // Receive
+            beast::flat_buffer buffer;
+            http::response<http::string_body> res;
+            boost::system::error_code rec;
+            http::read(stream, buffer, res, rec);
+
+            if (rec == http::error::end_of_stream || !res.keep_alive()) {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Server closed connection after response; reconnecting…");
+                boost::system::error_code sec;
+                stream.socket().shutdown(tcp::socket::shutdown_both, sec);
+                stream.socket().close(sec);
+                stream.connect(results, ec);
+                if (ec) {
+                    SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Reconnect failed: {}", ec.message());
+                    return;
+                }
+                if (rec) {
+                    // No response at all: resend the case on the new connection.
+                    rate.on_overload(std::chrono::seconds(1));
+                    continue;
+                }
+            } else if (rec) {
+                throw beast::system_error{rec};
+            }
 
-        // Receive
-        beast::flat_buffer buffer;
-        http::response<http::string_body> res;
-        boost::system::error_code rec;
-        http::read(stream, buffer, res, rec);
-
-        if (rec == http::error::end_of_stream || !res.keep_alive()) {
-            SPDLOG_LOGGER_WARN(Logger::instance(), "Server closed connection after response; reconnecting…");
-            boost::system::error_code sec;
-            stream.socket().shutdown(tcp::socket::shutdown_both, sec);
-            stream.socket().close(sec);
-            stream.connect(results, ec);
-            if (ec) {
-                SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Reconnect failed: {}", ec.message());
-                return;
+            tracer.span("submit", trace_id, submit_start_us, Tracer::now_us());
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Response: code = {}", res.result_int());
+            SPDLOG_LOGGER_INFO(Logger::instance(), "body = {}", res.body());
+            SPDLOG_LOGGER_INFO(Logger::instance(), "keep alive = {}", res.keep_alive());
+
+            if (res.result_int() / 100 == 2)
+            {
+                rate.on_accepted();
+                break;
+            }
+            if (!is_overload(res.result()))
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "{} refused ({}): {}", case_id, res.result_int(), res.body());
+                pipeline.reject(simulator, version, case_id);
+                break;
             }
-        } else if (rec) {
-            throw beast::system_error{rec};
+            rate.on_overload(retry_after_of(res));
+            SPDLOG_LOGGER_WARN(Logger::instance(), "{} rejected ({}), retrying at {:.1f} cases/s",
+                               case_id, res.result_int(), rate.rate());
         }
-
-        SPDLOG_LOGGER_INFO(Logger::instance(), "Response: code = {}", res.result_int());
-        SPDLOG_LOGGER_INFO(Logger::instance(), "body = {}", res.body());
-        SPDLOG_LOGGER_INFO(Logger::instance(), "keep alive = {}", res.keep_alive());
     }
 }
 
 class HttpSession : public std::enable_shared_from_this<HttpSession>
 {
 public:
-    explicit HttpSession(tcp::socket socket) : _stream(std::move(socket))
+    explicit HttpSession(tcp::socket socket, ResultPipeline &pipeline) : _stream(std::move(socket)), _pipeline(pipeline)
     {
     }
 
@@ -205,6 +625,7 @@ private:
     beast::tcp_stream _stream;
     beast::flat_buffer _buffer;
     http::request<http::string_body> _req;
+    ResultPipeline &_pipeline;
 
     void do_read()
     {
@@ -234,7 +655,11 @@ private:
     void handle_request()
     {
         SPDLOG_LOGGER_INFO(Logger::instance(), "Got request: {}", std::string(_req.method_string()));
-        SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", _req.body());
+        bool use_wire = wire::is_wire(_req[http::field::content_type]);
+        if (use_wire)
+            SPDLOG_LOGGER_INFO(Logger::instance(), "body: {} bytes (wire)", _req.body().size());
+        else
+            SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", _req.body());
 
         if (_req.method() != http::verb::post || _req.target() != app_target)
         {
@@ -245,6 +670,29 @@ private:
 
         try
         {
+            try
+            {
+                if (use_wire)
+                {
+                    SimulationResult result;
+                    from_wire(_req.body(), result);
+                    _pipeline.submit(std::move(result));
+                }
+                else
+                {
+                    // A DagResult is told apart from a SimulationResult by its dag_id.
+                    json body = json::parse(_req.body());
+                    if (body.contains("dag_id"))
+                        _pipeline.submit(body.get<DagResult>());
+                    else
+                        _pipeline.submit(body.get<SimulationResult>());
+                }
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Invalid result body: {}", e.what());
+            }
+
             auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
             res->set(http::field::content_type, "text/plain");
             res->set(http::field::connection, "keep-alive");
@@ -278,17 +726,48 @@ int main(int argc, char *argv[])
     Logger::init(cfg);
     SPDLOG_LOGGER_INFO(Logger::instance(), "Logger Loads Successfully!");
 
+    std::string trace_path = cli_option(argc, argv, "--trace");
+    if (!trace_path.empty() && !tracer.open(trace_path, "app"))
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to open trace file: {}", trace_path);
+        return -1;
+    }
+
+    try
+    {
+        zstd_options.level = zstd_level;
+        zstd_options.dictionary = compression::load_dictionary(zstd_dictionary_path);
+    }
+    catch (const std::exception &e)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "{}", e.what());
+        return -1;
+    }
+
     preInstall();
 
     SPDLOG_LOGGER_INFO(Logger::instance(), "Get App Id {}", app_id);
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Mount NFS");
-    SPDLOG_LOGGER_INFO(Logger::instance(), mount_nfs_command(app_id));
-    int code = safe_system(mount_nfs_command(app_id));
-    if (code != 0)
+    std::string backend = cli_option(argc, argv, "--storage", storage_backend);
+    case_storage = storage::make(backend, nfs_mnt_dir, mount_nfs_command(app_id), unmount_nfs_command(),
+                                 local_storage_dir / app_id, shm_storage_dir / app_id);
+    if (!case_storage)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unknown storage backend: {} (nfs, local or shm)", backend);
+        return -1;
+    }
+    try
+    {
+        case_storage->attach();
+    }
+    catch (const std::exception &e)
     {
-        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Mount NFS Failed");
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "{}", e.what());
         return -1;
     }
+    case_root = case_storage->root();
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Case files on {} storage at {}", case_storage->name(), case_root.string());
+
+    ResultPipeline pipeline(result_io_threads);
 
     net::io_context ioc;
     auto work = net::make_work_guard(ioc); // Prevent io_context from exiting prematurely
@@ -298,7 +777,7 @@ int main(int argc, char *argv[])
     auto do_accept = [&](auto &&self) -> void {
         acceptor.async_accept([&](beast::error_code ec, tcp::socket socket) {
             if (!ec)
-                std::make_shared<HttpSession>(std::move(socket))->run();
+                std::make_shared<HttpSession>(std::move(socket), pipeline)->run();
             self(self);
         });
     };
@@ -313,7 +792,7 @@ int main(int argc, char *argv[])
 
     SPDLOG_LOGGER_INFO(Logger::instance(), "The server starts at http://localhost:" + std::to_string(app_port));
 
-    post_requests(1, ioc);
+    post_requests(1, ioc, pipeline);
 
     for (auto &t : threads)
         t.join();
@@ -0,0 +1,110 @@
+#pragma once
+
+// Tiny harness shared by the programs in bench/: times a callable and counts the heap
+// allocations it makes. It replaces the global operator new/delete, so include it from
+// exactly one translation unit per benchmark binary. On x86-64 it also reports TSC cycles,
+// which tick at the nominal clock rate rather than the (turbo) core clock.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace bench
+{
+
+inline std::atomic<std::size_t> allocations{0};
+
+// Keep the compiler from optimising away a value computed by the benchmark body.
+template <class T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+inline std::uint64_t cycles()
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Result
+{
+    double ns_per_op;
+    double allocs_per_op;
+    double cycles_per_op; // 0 where no cycle counter is read
+};
+
+// Times body without printing, for callers that must keep stdout quiet while it runs.
+template <class F>
+Result measure(std::size_t iterations, F &&body)
+{
+    for (std::size_t i = 0; i < iterations / 10 + 1; ++i) // warm-up
+        body();
+
+    std::size_t allocs_before = allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t start_cycles = cycles();
+    for (std::size_t i = 0; i < iterations; ++i)
+        body();
+    std::uint64_t elapsed_cycles = cycles() - start_cycles;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+
+    return Result{
+        std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations),
+        static_cast<double>(allocs) / static_cast<double>(iterations),
+        static_cast<double>(elapsed_cycles) / static_cast<double>(iterations),
+    };
+}
+
+inline void report(const char *name, const Result &r)
+{
+    if (r.cycles_per_op > 0)
+        std::printf("%-44s %12.1f ns/op %12.1f cycles/op %10.2f allocs/op\n", name, r.ns_per_op, r.cycles_per_op, r.allocs_per_op);
+    else
+        std::printf("%-44s %12.1f ns/op %10.2f allocs/op\n", name, r.ns_per_op, r.allocs_per_op);
+}
+
+template <class F>
+Result run(const char *name, std::size_t iterations, F &&body)
+{
+    Result r = measure(iterations, std::forward<F>(body));
+    report(name, r);
+    return r;
+}
+
+} // namespace bench
+
+// GCC cannot see that these replacements pair malloc with free.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(std::size_t size)
+{
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#pragma GCC diagnostic pop
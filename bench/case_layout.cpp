@@ -0,0 +1,68 @@
+// Create and lookup rates of case directories in the flat legacy layout versus the sharded layout
+// (utils/case_layout.hpp). Run it on the storage in question, e.g. an NFS mount:
+//   bench_case_layout 1000000 /mnt/nfs/sim/bench
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils/case_layout.hpp"
+
+namespace fs = std::filesystem;
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point start)
+{
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static void run(const char *name, const fs::path &sweep, const case_layout::Layout &layout, std::size_t cases)
+{
+    fs::remove_all(sweep);
+    fs::create_directories(sweep);
+
+    // What the app does per case: create the case directory and write the input file.
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < cases; ++i)
+    {
+        std::string case_id = "case" + std::to_string(i);
+        fs::path dir = case_layout::case_dir(sweep, case_id, layout);
+        fs::create_directories(dir);
+        std::ofstream(dir / "input") << "10 20\n";
+    }
+    double create_s = seconds_since(start);
+
+    // What the sim server and the app do per case: resolve and open files of a known case.
+    std::vector<std::size_t> order(cases);
+    for (std::size_t i = 0; i < cases; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64{42});
+    std::size_t found = 0;
+    start = clock_type::now();
+    for (std::size_t i : order)
+    {
+        std::error_code ec;
+        found += fs::exists(case_layout::case_dir(sweep, "case" + std::to_string(i), layout) / "input", ec);
+    }
+    double lookup_s = seconds_since(start);
+
+    std::printf("%-28s %9zu cases  create %10.0f cases/s  lookup %10.0f cases/s%s\n", name, cases,
+                cases / create_s, cases / lookup_s, found == cases ? "" : "  (MISSING FILES)");
+    fs::remove_all(sweep);
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t cases = argc > 1 ? std::stoul(argv[1]) : 100000;
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "bench_case_layout";
+
+    run("flat (legacy)", root / "flat", {0, 2}, cases);
+    run("sharded 1 x 256", root / "sharded1", {1, 2}, cases);
+    run("sharded 2 x 256", root / "sharded2", {2, 2}, cases);
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,181 @@
+// CPU cost of the pieces on the sim server's request path, one row per component: body codecs,
+// case paths, the simulator command line, response bodies, HTTP parse/serialize and log calls.
+// Run with `make microbench`; `bench_microbench [iterations] [filter]` runs the rows whose name
+// contains filter. Compare ns, cycles and allocations per op across commits.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <nlohmann/json.hpp>
+
+#include "types/sim_server.hpp"
+#include "utils/common.hpp"
+#include "utils/Logger.hpp"
+#include "bench.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using json = nlohmann::json;
+
+static std::size_t iterations = 200000;
+static const char *filter = "";
+
+static bool selected(const char *name)
+{
+    return std::strstr(name, filter) != nullptr;
+}
+
+template <class F>
+static void run(const char *name, F &&body)
+{
+    if (selected(name))
+        bench::run(name, iterations, std::forward<F>(body));
+}
+
+// Serializes a response the way http::async_write does, into out.
+static void serialize(http::response<http::string_body> &res, std::string &out)
+{
+    http::response_serializer<http::string_body> sr{res};
+    beast::error_code ec;
+    do
+    {
+        sr.next(ec, [&](beast::error_code &, const auto &buffers) {
+            for (auto b : beast::buffers_range_ref(buffers))
+                out.append(static_cast<const char *>(b.data()), b.size());
+            sr.consume(beast::buffer_bytes(buffers));
+        });
+    } while (!ec && !sr.is_done());
+}
+
+// Log calls as the handlers make them, with the level and sinks of a default start (info, console).
+// stdout goes to /dev/null meanwhile, so the rows are printed afterwards. TRACE and DEBUG are
+// compiled out below SPDLOG_ACTIVE_LEVEL; the logger->debug() row is the runtime level check.
+static void logger_rows()
+{
+    LogConfig cfg;
+    Logger::init(cfg);
+    const std::string target = "/submit";
+    const std::size_t bytes = 227;
+    std::size_t log_iterations = iterations / 10 + 1; // each info+ call is a write(2)
+
+    struct Row
+    {
+        const char *name;
+        bench::Result result;
+    };
+    Row rows[7] = {};
+    std::size_t n = 0;
+    auto measure = [&](const char *name, auto &&body) {
+        if (selected(name))
+            rows[n++] = {name, bench::measure(log_iterations, body)};
+    };
+
+    std::fflush(stdout);
+    int saved = ::dup(STDOUT_FILENO);
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    ::dup2(null_fd, STDOUT_FILENO);
+    measure("Logger TRACE (compiled out)", [&] { SPDLOG_LOGGER_TRACE(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger DEBUG (compiled out)", [&] { SPDLOG_LOGGER_DEBUG(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger debug() (filtered at runtime)", [&] { Logger::instance()->debug("Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger INFO", [&] { SPDLOG_LOGGER_INFO(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger WARN", [&] { SPDLOG_LOGGER_WARN(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger ERROR", [&] { SPDLOG_LOGGER_ERROR(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    measure("Logger CRITICAL", [&] { SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Got request: {} {}, bytes: {}", "POST", target, bytes); });
+    std::fflush(stdout);
+    ::dup2(saved, STDOUT_FILENO);
+    ::close(saved);
+    ::close(null_fd);
+
+    for (std::size_t i = 0; i < n; ++i)
+        bench::report(rows[i].name, rows[i].result);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        iterations = std::stoul(argv[1]);
+    if (argc > 2)
+        filter = argv[2];
+
+    const std::string body =
+        R"({"simulator":"simple_sim","version":"1.0","app_id":"power","case_id":"case12345","inputfile":"input"})";
+    const SimulationResult result{"simple_sim", "1.0", "power", "case12345", "/mnt/nfs/sim/power/simple_sim/1.0/ab/case12345/output", true};
+    const std::string raw_request =
+        "POST /submit HTTP/1.1\r\n"
+        "Host: 127.0.0.1:9000\r\n"
+        "User-Agent: Boost.Beast/330\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "\r\n" + body;
+
+    run("from_json(SimulationTask&)", [&] {
+        SimulationTask task = json::parse(body).get<SimulationTask>();
+        bench::do_not_optimize(task);
+    });
+    SimulationTaskView view;
+    SimulationTask task;
+    run("parse_task + assign_task (reused)", [&] {
+        if (parse_task(body, view))
+            assign_task(view, task);
+        bench::do_not_optimize(task);
+    });
+    run("to_json(SimulationResult).dump()", [&] {
+        std::string out = json(result).dump();
+        bench::do_not_optimize(out);
+    });
+    std::string out;
+    run("write_result (reused)", [&] {
+        out.clear();
+        write_result(out, result);
+        bench::do_not_optimize(out);
+    });
+    run("abs_input_file_path", [&] {
+        fs::path path = abs_input_file_path(task.simulator, task.version, task.app_id, task.case_id, "input");
+        bench::do_not_optimize(path);
+    });
+    run("abs_output_file_path", [&] {
+        fs::path path = abs_output_file_path(task.simulator, task.version, task.app_id, task.case_id);
+        bench::do_not_optimize(path);
+    });
+    run("simulator_exec_command", [&] {
+        std::string command = simulator_exec_command(task.simulator, task.version, task.inputfile, task.outputfile);
+        bench::do_not_optimize(command);
+    });
+    run("simulator_exec_argv", [&] {
+        auto argv = simulator_exec_argv(task.simulator, task.version, task.inputfile, task.outputfile);
+        bench::do_not_optimize(argv);
+    });
+    run("error_response_body", [&] {
+        std::string s = error_response_body("Simulator NOT exist");
+        bench::do_not_optimize(s);
+    });
+    run("message_response_body", [&] {
+        std::string s = message_response_body("Request received");
+        bench::do_not_optimize(s);
+    });
+    run("beast parse POST /submit", [&] {
+        http::request_parser<http::string_body> parser;
+        parser.eager(true);
+        beast::error_code ec;
+        auto buffer = net::buffer(raw_request);
+        while (!ec && !parser.is_done() && buffer.size() > 0)
+            buffer += parser.put(buffer, ec);
+        bench::do_not_optimize(parser.get());
+    });
+    run("beast build + serialize ack response", [&] {
+        http::response<http::string_body> res{http::status::ok, 11};
+        res.set(http::field::content_type, "application/json");
+        res.keep_alive(true);
+        res.body() = message_response_body("Request received");
+        res.prepare_payload();
+        out.clear();
+        serialize(res, out);
+        bench::do_not_optimize(out);
+    });
+    logger_rows();
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Per-case start-up and I/O cost of a simulator: the hand-rolled iostream code simulators used
+// before the SDK versus include/sdk/simulator.hpp, on simple_sim's input and on a larger JSON input.
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+#include "sdk/simulator.hpp"
+#include "utils/Logger.hpp"
+#include "bench.hpp"
+
+static void write_file(const std::string &path, const std::string &content)
+{
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    std::string small_in = dir + "/bench_sim_small_input";
+    std::string large_in = dir + "/bench_sim_large_input";
+    std::string out = dir + "/bench_sim_output";
+
+    write_file(small_in, "10 20\n");
+    std::string large;
+    while (large.size() < (1 << 20))
+        large += R"({"switch": 12, "table": 0, "priority": 100, "match": {"in_port": 3, "eth_type": 2048}, "actions": ["output:4"]},)" "\n";
+    write_file(large_in, large);
+
+    // Start-up: the SDK only initialises the Logger when a simulator logs.
+    auto start = std::chrono::steady_clock::now();
+    Logger::init(LogConfig{});
+    auto init_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-44s %12.1f us (once per process, skipped by the SDK unless logging)\n\n", "Logger::init", init_us);
+
+    bench::run("small: ifstream >> / ofstream <<", iterations, [&] {
+        std::ifstream in(small_in);
+        int a = 0, b = 0;
+        in >> a >> b;
+        std::ofstream o(out);
+        o << a + b << "\n";
+    });
+    bench::run("small: MappedFile / OutputFile (no fsync)", iterations, [&] {
+        sim_sdk::MappedFile in(small_in);
+        bench::do_not_optimize(in.data());
+        sim_sdk::OutputFile o(out, false);
+        o.print("{}\n", 30);
+        o.commit();
+    });
+    bench::run("small: MappedFile / OutputFile (fsync)", iterations / 10 + 1, [&] {
+        sim_sdk::MappedFile in(small_in);
+        bench::do_not_optimize(in.data());
+        sim_sdk::OutputFile o(out);
+        o.print("{}\n", 30);
+        o.commit();
+    });
+
+    std::size_t large_iterations = iterations / 20 + 1;
+    bench::run("1 MiB: ifstream -> string / ofstream", large_iterations, [&] {
+        std::ifstream in(large_in, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream o(out, std::ios::binary);
+        o << content;
+    });
+    bench::run("1 MiB: MappedFile / OutputFile (no fsync)", large_iterations, [&] {
+        sim_sdk::MappedFile in(large_in);
+        sim_sdk::OutputFile o(out, false);
+        o.write(in.data());
+        o.commit();
+    });
+
+    ::unlink(small_in.c_str());
+    ::unlink(large_in.c_str());
+    ::unlink(out.c_str());
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Process spawn and reap rate: boost::process (fork/exec, SIGCHLD via signal_set) versus
+// ProcessSupervisor (posix_spawn, pidfd, waitid). Runs <count> short-lived children with at most
+// <concurrency> alive at a time, optionally after touching <ballast MiB> of heap to give the parent
+// the resident set of a busy server, which fork has to copy page tables for:
+//   bench_spawn_rate [count] [concurrency] [ballast MiB] [program]
+#include <boost/asio.hpp>
+#include <boost/process.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/process_supervisor.hpp"
+
+namespace net = boost::asio;
+namespace bp  = boost::process;
+using clock_type = std::chrono::steady_clock;
+
+struct Stats
+{
+    double seconds = 0;
+    double spawn_us = 0; // mean time spent in the spawn call
+    std::size_t failed = 0;
+};
+
+// Keeps `concurrency` children alive until `count` have completed; start(done) launches one child.
+static Stats drive(net::io_context &ioc, std::size_t count, std::size_t concurrency,
+                   const std::function<void(std::function<void(bool)>)> &start)
+{
+    Stats stats;
+    std::size_t started = 0, completed = 0;
+    double spawn_total = 0;
+    std::function<void()> launch = [&]
+    {
+        if (started == count)
+            return;
+        ++started;
+        auto t0 = clock_type::now();
+        start([&](bool ok)
+        {
+            stats.failed += !ok;
+            if (++completed == count)
+                ioc.stop();
+            launch();
+        });
+        spawn_total += std::chrono::duration<double, std::micro>(clock_type::now() - t0).count();
+    };
+
+    auto begin = clock_type::now();
+    for (std::size_t i = 0; i < concurrency; ++i)
+        net::post(ioc, launch);
+    ioc.run();
+    ioc.restart();
+    stats.seconds = std::chrono::duration<double>(clock_type::now() - begin).count();
+    stats.spawn_us = spawn_total / static_cast<double>(count);
+    return stats;
+}
+
+static void report(const char *name, std::size_t count, const Stats &s)
+{
+    std::printf("%-22s %8.0f children/s  spawn call %8.1f us%s\n", name, count / s.seconds, s.spawn_us,
+                s.failed ? "  (FAILURES)" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = argc > 1 ? std::stoul(argv[1]) : 2000;
+    std::size_t concurrency = argc > 2 ? std::stoul(argv[2]) : 64;
+    std::size_t ballast_mb = argc > 3 ? std::stoul(argv[3]) : 0;
+    std::string program = argc > 4 ? argv[4] : "/bin/true";
+
+    std::vector<char> ballast(ballast_mb << 20);
+    std::memset(ballast.data(), 1, ballast.size());
+    std::printf("%zu children of %s, %zu at a time, %zu MiB resident ballast\n",
+                count, program.c_str(), concurrency, ballast_mb);
+
+    net::io_context ioc;
+
+    // The previous run_simulator path.
+    std::vector<std::shared_ptr<bp::child>> keep;
+    report("boost::process", count, drive(ioc, count, concurrency, [&](std::function<void(bool)> done)
+    {
+        // Like run_simulator did, leave the exit handler before starting the next child:
+        // boost 1.74's sigchld_service breaks when a child is spawned from inside on_exit.
+        auto child = std::make_shared<bp::child>(program,
+            bp::on_exit = [&ioc, done](int code, const std::error_code &ec)
+            {
+                net::post(ioc, [done, ok = !ec && code == 0] { done(ok); });
+            }, ioc);
+        keep.push_back(child);
+    }));
+    keep.clear();
+
+    ProcessSupervisor supervisor(ioc);
+    std::vector<std::string> args{program};
+    report("ProcessSupervisor", count, drive(ioc, count, concurrency, [&](std::function<void(bool)> done)
+    {
+        supervisor.spawn(args, [done](const ProcessSupervisor::Exit &exit, std::error_code ec)
+        {
+            done(!ec && exit.code == 0);
+        });
+    }));
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Compares the nlohmann DOM path with the schema-specific codec in types/sim_server.hpp,
+// and checks that both produce identical tasks and result bodies.
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "types/sim_server.hpp"
+#include "bench.hpp"
+
+using json = nlohmann::json;
+
+static bool same_task(const SimulationTask &a, const SimulationTask &b)
+{
+    return a.simulator == b.simulator && a.version == b.version && a.app_id == b.app_id &&
+           a.case_id == b.case_id && a.inputfile == b.inputfile && a.outputfile == b.outputfile &&
+           a.trace_id == b.trace_id && a.codec == b.codec;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    // Identity checks, including bodies that take the fallback path.
+    const std::vector<std::string> bodies = {
+        R"({"simulator":"simple_sim","version":"1.0","app_id":"power","case_id":"case12345","inputfile":"input"})",
+        R"( { "inputfile" : "in/put.json", "case_id":"c", "extra": 12, "app_id":"7","version":"2.1","simulator":"s" } )",
+        R"({"simulator":"s","version":"1","app_id":"a","case_id":"c","inputfile":"/abs/input"})",
+        R"({"simulator":"s","version":"1","app_id":"a","case_id":"c","inputfile":"input","trace_id":"00ff"})",
+        R"({"simulator":"s","version":"1","app_id":"a","case_id":"c","inputfile":"input.zst","codec":"zstd"})",
+        R"({"simulator":"s\"q","version":"1","app_id":"a","case_id":"c","inputfile":"input"})",
+        R"({"simulator":"sé","version":"1","app_id":"a","case_id":"c","inputfile":"input"})",
+    };
+    bool identical = true;
+    for (auto &body : bodies)
+    {
+        SimulationTask dom = json::parse(body).get<SimulationTask>();
+        SimulationTask fast;
+        SimulationTaskView view;
+        if (parse_task(body, view))
+            assign_task(view, fast);
+        else
+            fast = json::parse(body).get<SimulationTask>();
+        identical = identical && same_task(dom, fast);
+    }
+    // Literals the fast path must reject like nlohmann does, and valid ones it must keep accepting.
+    const std::vector<std::string> literals = {
+        "bar", "1-2", "nul", "truex", "01", "-", "1.", ".5", "1e", "1e+", "+1", "--1", "1.2.3",
+        "0", "-12", "3.25", "-0.5e+10", "1E5", "2e-3", "true", "false", "null",
+    };
+    for (auto &literal : literals)
+    {
+        std::string body = R"({"simulator":"s","version":"1","app_id":"a","case_id":"c","inputfile":"i","x":)" + literal + "}";
+        bool valid = json::accept(body);
+        SimulationTaskView view;
+        identical = identical && parse_task(body, view) == valid;
+    }
+    const std::vector<SimulationResult> results = {
+        {"simple_sim", "1.0", "power", "case12345", "output", true},
+        {"s\"\\\n\x01", "1.0", "a", "c", "output", false},
+        {"s\xc3\xa9", "1.0", "a", "c", "output", true},
+        {"simple_sim", "1.0", "power", "case1", "output", true, "0123456789abcdef"},
+        {"simple_sim", "1.0", "power", "case1", "output.zst", true, "0123456789abcdef", "zstd"},
+        {"simple_sim", "1.0", "power", "case1", "output", true, "", "", ResourceUsage{1500000, 1200000, 30000, 8828, 4096, 18446744073709551615ull, 12, 3}},
+    };
+    for (auto &result : results)
+    {
+        std::string fast;
+        write_result(fast, result);
+        identical = identical && fast == json(result).dump();
+    }
+    std::printf("fast path identical to nlohmann: %s\n\n", identical ? "yes" : "NO");
+
+    const std::string &body = bodies[0];
+    const SimulationResult &result = results[0];
+
+    bench::run("parse SimulationTask (nlohmann DOM)", iterations, [&] {
+        SimulationTask task = json::parse(body).get<SimulationTask>();
+        bench::do_not_optimize(task);
+    });
+    SimulationTaskView view;
+    bench::run("parse SimulationTask (fast, view only)", iterations, [&] {
+        bool ok = parse_task(body, view);
+        bench::do_not_optimize(ok);
+    });
+    SimulationTask task;
+    bench::run("parse SimulationTask (fast, reused task)", iterations, [&] {
+        if (parse_task(body, view))
+            assign_task(view, task);
+        bench::do_not_optimize(task);
+    });
+    bench::run("serialize SimulationResult (nlohmann DOM)", iterations, [&] {
+        std::string out = json(result).dump();
+        bench::do_not_optimize(out);
+    });
+    std::string out;
+    bench::run("serialize SimulationResult (fast, reused)", iterations, [&] {
+        out.clear();
+        write_result(out, result);
+        bench::do_not_optimize(out);
+    });
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+// Compares JSON and the binary wire encoding (utils/wire.hpp) for the sim server's messages.
+#include <cstdio>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include "types/sim_server.hpp"
+#include "bench.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[])
+{
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    const std::string task_json =
+        R"({"simulator":"simple_sim","version":"1.0","app_id":"power","case_id":"case12345","inputfile":"input"})";
+    std::string task_wire;
+    {
+        wire::Writer w(task_wire, wire::Kind::Request);
+        for (const char *field : {"simple_sim", "1.0", "power", "case12345", "input"})
+            w.put_string(field);
+        w.finish();
+    }
+    const SimulationResult result{"simple_sim", "1.0", "power", "case12345", "output", true};
+
+    std::string result_wire;
+    to_wire(result_wire, result);
+    std::printf("task size:   json %zu bytes, wire %zu bytes\n", task_json.size(), task_wire.size());
+    std::printf("result size: json %zu bytes, wire %zu bytes\n\n", json(result).dump().size(), result_wire.size());
+
+    auto task_json_r = bench::run("decode SimulationTask (json)", iterations, [&] {
+        SimulationTask task = json::parse(task_json).get<SimulationTask>();
+        bench::do_not_optimize(task);
+    });
+    auto task_wire_r = bench::run("decode SimulationTask (wire)", iterations, [&] {
+        SimulationTask task;
+        from_wire(task_wire, task);
+        bench::do_not_optimize(task);
+    });
+    auto result_json_r = bench::run("encode SimulationResult (json)", iterations, [&] {
+        std::string body = json(result).dump();
+        bench::do_not_optimize(body);
+    });
+    std::string body;
+    auto result_wire_r = bench::run("encode SimulationResult (wire)", iterations, [&] {
+        body.clear();
+        to_wire(body, result);
+        bench::do_not_optimize(body);
+    });
+
+    std::printf("\nspeedup: decode task %.1fx, encode result %.1fx\n",
+                task_json_r.ns_per_op / task_wire_r.ns_per_op, result_json_r.ns_per_op / result_wire_r.ns_per_op);
+    return 0;
+}
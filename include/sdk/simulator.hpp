@@ -0,0 +1,144 @@
+#pragma once
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// Simulator SDK: what every program in registered/ needs, so that simulators only contain the model.
+// Link against sdk/libndtsim.a (which also carries the Logger).
+//
+//   int main(int argc, char *argv[])
+//   {
+//       return sim_sdk::run(argc, argv, [](sim_sdk::Case &c) {
+//           std::string_view input = c.input().data();   // memory-mapped
+//           c.output().print("{}\n", compute(input));     // published atomically on success
+//           return EXIT_SUCCESS;
+//       });
+//   }
+//
+// Command line: <input> <output> [<input> <output> ...] [--logfile|-f] [--loglevel|-l <level>]
+// Every input/output pair is one case. The sim server passes one pair; several pairs (e.g. from a
+// script) form a batch that is handled by one process, so start-up is paid once.
+//
+// Sim server hook, inactive unless the server sets it up:
+//   NDT_CHECKPOINT_FILE=<path>  Set for simulators registered with a "checkpointable" marker file.
+//                         SIGUSR1 asks the case to stop: Case::checkpoint_requested() turns true,
+//                         and the handler saves its state with Case::save_checkpoint() and returns
+//                         checkpoint_exit_code. The case is run again later; Case::load_checkpoint()
+//                         then returns the saved state. Single-case runs only.
+namespace sim_sdk
+{
+
+// Exit status of a process that saved a checkpoint on request (EX_TEMPFAIL).
+inline constexpr int checkpoint_exit_code = 75;
+
+// Read-only view of a whole file. Files from mmap_threshold up are memory-mapped; smaller ones are
+// read into memory, which is cheaper than setting up and tearing down a mapping.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path); // throws std::system_error
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    static constexpr std::size_t mmap_threshold = 1 << 16;
+
+    std::string_view data() const { return {data_, size_}; }
+    const std::string &path() const { return path_; }
+
+private:
+    std::string path_;
+    std::string small_; // contents of files below mmap_threshold
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+};
+
+// Buffered output that is written to "<path>.tmp" and only appears at path once commit() has
+// flushed it, fsync'ed it (when durable) and renamed it over path. Uncommitted output is discarded.
+class OutputFile
+{
+public:
+    explicit OutputFile(std::string path, bool durable = true);
+    ~OutputFile();
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    void write(std::string_view s)
+    {
+        buffer_.append(s.data(), s.size());
+        if (buffer_.size() >= buffer_limit)
+            flush();
+    }
+
+    template <class... Args>
+    void print(fmt::format_string<Args...> format, Args &&...args)
+    {
+        fmt::format_to(std::back_inserter(buffer_), format, std::forward<Args>(args)...);
+        if (buffer_.size() >= buffer_limit)
+            flush();
+    }
+
+    void commit(); // throws std::system_error
+    bool committed() const { return committed_; }
+    const std::string &path() const { return path_; }
+
+private:
+    static constexpr std::size_t buffer_limit = 1 << 16;
+
+    std::string path_;
+    std::string tmp_path_;
+    std::string buffer_;
+    int fd_ = -1;
+    bool durable_;
+    bool committed_ = false;
+
+    void flush();
+};
+
+class Case
+{
+public:
+    Case(std::size_t index, std::string input_path, std::string output_path)
+    : index_(index), input_path_(std::move(input_path)), output_path_(std::move(output_path)) {}
+
+    std::size_t index() const { return index_; }
+    const std::string &input_path() const { return input_path_; }
+    const std::string &output_path() const { return output_path_; }
+
+    // Mapped / opened on first use.
+    const MappedFile &input();
+    OutputFile &output();
+
+    // Checkpointing; all of these are inert unless the sim server set NDT_CHECKPOINT_FILE.
+    bool checkpoint_requested() const;               // SIGUSR1 received; cheap enough for every step
+    std::optional<std::string> load_checkpoint();    // state saved by an earlier run of this case
+    void save_checkpoint(std::string_view state);    // durable once it returns; throws std::system_error
+
+private:
+    friend int run(int, char *[], const std::function<int(Case &)> &);
+
+    std::size_t index_;
+    std::string input_path_;
+    std::string output_path_;
+    std::optional<MappedFile> input_;
+    std::optional<OutputFile> output_;
+};
+
+// The shared Logger, initialised from the command line on first use, so that simulators which do
+// not log never pay for setting up spdlog.
+std::shared_ptr<spdlog::logger> logger();
+
+// Runs handler for every case on the command line. A case succeeds when the handler returns 0; its
+// output is then committed if the handler did not do so itself. Exceptions fail the case. Returns
+// EXIT_SUCCESS only if every case succeeded, and checkpoint_exit_code as soon as a handler returns
+// it after a checkpoint was requested.
+int run(int argc, char *argv[], const std::function<int(Case &)> &handler);
+
+} // namespace sim_sdk
@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <string>
+#include "settings/case_layout.hpp"
 
 namespace fs = std::filesystem;
 
@@ -21,13 +22,43 @@ inline const std::string ndt_target = "/ndt/app_register";
 inline const std::string request_manager_ip = "10.10.10.250";
 inline const std::string request_manager_port = "8000";
 inline const std::string request_manager_target_for_app = "/ndt/received_a_simulation_case";
+// AIMD submission pacing (cases per second): +increase per accepted case, *decrease on 429/503.
+inline const double submit_initial_rate = 50.0;
+inline const double submit_min_rate = 1.0;
+inline const double submit_max_rate = 2000.0;
+inline const double submit_rate_increase = 5.0;
+inline const double submit_rate_decrease = 0.5;
+// Submit cases with the compact binary encoding (utils/wire.hpp) instead of JSON.
+inline const bool use_wire_protocol = false;
+// Input-affinity key sent with every case, e.g. the path of a base file all cases read, so that they
+// are placed on the same sim server and NUMA node; empty spreads cases by their id.
+inline const std::string case_affinity = "";
 
 // inline const std::string nfs_server_ip = "127.0.0.1";
 inline const std::string nfs_server_ip = "10.10.10.250";
 inline const fs::path nfs_mnt_dir = "/mnt/nfs/app";
 
+// Storage of the case files (utils/storage.hpp), chosen at startup with --storage <backend> and
+// matching the sim servers': "nfs" mounts this app's directory of the export on nfs_mnt_dir,
+// "local" and "shm" use <local_storage_dir|shm_storage_dir>/<app_id> on this host. case_root is the
+// root of the selected backend.
+inline const std::string storage_backend = "nfs";
+inline const fs::path local_storage_dir = "/srv/nfs/sim";
+inline const fs::path shm_storage_dir = "/dev/shm/ndt/sim";
+inline fs::path case_root = nfs_mnt_dir;
+
 inline const fs::path input_filename = "input";
 
+// Case file compression (utils/compression.hpp): "" writes plain inputs, "zstd" compressed ones
+// (input.zst); outputs then come back compressed as well. The sim servers must use the same dictionary.
+inline const std::string case_codec = "";
+inline const int zstd_level = 3;
+inline const fs::path zstd_dictionary_path = "";
+
+// Result ingest: number of threads reading output files, and the per-sweep summary written on completion.
+inline const std::size_t result_io_threads = 4;
+inline const fs::path summary_filename = "summary.json";
+
 inline std::string mount_nfs_command(const std::string& app_id)
 {
     return "mount -t nfs " + nfs_server_ip + ":" + "/srv/nfs/sim/" + app_id + " " + nfs_mnt_dir.string();
@@ -44,7 +75,7 @@ inline fs::path abs_input_file_path(
     const std::string &case_id,
     const std::string &input_file_path)
 {
-    return nfs_mnt_dir / simulator / version / case_id / input_file_path;
+    return case_layout::case_dir(case_root / simulator / version, case_id, case_dir_layout) / input_file_path;
 }
 
 inline fs::path abs_output_file_path(
@@ -53,5 +84,18 @@ inline fs::path abs_output_file_path(
     const std::string &case_id,
     const std::string &output_file_path)
 {
-    return nfs_mnt_dir / simulator / version / case_id / output_file_path;
+    fs::path sweep = case_root / simulator / version;
+    fs::path dir = case_layout_legacy_fallback ? case_layout::locate_case_dir(sweep, case_id, case_dir_layout)
+                                               : case_layout::case_dir(sweep, case_id, case_dir_layout);
+    return dir / output_file_path;
+}
+
+inline fs::path sweep_summary_path(const std::string &simulator, const std::string &version)
+{
+    return case_root / simulator / version / summary_filename;
+}
+
+inline fs::path dag_summary_path(const std::string &dag_id)
+{
+    return case_root / "dags" / dag_id / summary_filename;
 }
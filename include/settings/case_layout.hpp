@@ -0,0 +1,11 @@
+#pragma once
+
+#include "utils/case_layout.hpp"
+
+// Shared by app, sim server and tools: all of them must place case directories the same way.
+// Two levels of 256 fan-out directories; {0} restores the flat legacy layout.
+inline const case_layout::Layout case_dir_layout{2, 2};
+
+// Also look for case directories in the legacy layout, for sweeps written before sharding. Readers
+// then stat the sharded directory, and the legacy one when it is missing.
+inline const bool case_layout_legacy_fallback = true;
@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -9,9 +10,41 @@ inline const std::string request_manager_ip = "127.0.0.1";
 inline const uint32_t request_manager_port = 8002;
 inline const std::string request_manager_target_for_sim_server = "/result";
 inline const std::string request_manager_target_for_app = "/submit";
+inline const std::string request_manager_target_for_register = "/ndt/app_register";
+inline const std::string request_manager_target_for_cases = "/cases";
+// DAG submissions are forwarded like single cases; their one DagResult is delivered to the app's
+// result URL like a SimulationResult, told apart by its dag_id. Sim servers post DagResults to
+// their request_manager_dag_target, which must be request_manager_target_for_dag_result.
+inline const std::string request_manager_target_for_dag = "/submit_dag";
+inline const std::string request_manager_target_for_dag_result = "/dag_result";
 
-inline const std::string sim_server_ip = "127.0.0.1";
-inline const std::string sim_server_port = "8003";
+// Sim servers that cases are dispatched to. A case goes to the owner of its input-affinity key (its
+// case id when it has none; a DAG's dag_id) on a consistent-hash ring with sim_server_virtual_nodes
+// points per server, so cases reading the same base file meet a warm page cache. While a server
+// answers 429/503 or cannot be reached, the case spills over to the next one on the ring.
+struct SimServerAddress
+{
+    std::string host;
+    std::string port;
+};
+inline const std::vector<SimServerAddress> sim_servers = {{"127.0.0.1", "8003"}};
+inline const std::size_t sim_server_virtual_nodes = 64;
 inline const std::string sim_server_target = "/submit";
+inline const std::string sim_server_dag_target = "/submit_dag";
 
-inline const std::string app_target = "/result";
+// Apps register their result URL at start-up. Routes unused for app_route_ttl_seconds (no
+// submission, result or re-registration) are dropped unless the app still has cases submitted or
+// queued; the sweep runs every app_route_sweep_seconds.
+inline const long app_route_ttl_seconds = 24 * 3600;
+inline const long app_route_sweep_seconds = 60;
+
+// Retry-After sent to the app when the sim server cannot be reached.
+inline const unsigned upstream_retry_after_seconds = 1;
+
+// State of every forwarded case, for apps that reconcile instead of relying on result callbacks:
+// GET /cases?app_id=<id>[&status=submitted|queued|rejected|completed|failed|skipped]
+// [&since=<unix time>][&cursor=<next_cursor>][&limit=<n>]. Cases not updated for
+// case_index_ttl_seconds are forgotten; "skipped" are DAG nodes whose parent failed.
+inline const std::size_t case_query_default_limit = 1000;
+inline const std::size_t case_query_max_limit = 10000;
+inline const long case_index_ttl_seconds = 7 * 24 * 3600;
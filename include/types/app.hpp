@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <nlohmann/json.hpp>
+#include "utils/wire.hpp"
 using json = nlohmann::json;
 
 struct SimulationRequest
@@ -11,6 +16,23 @@ struct SimulationRequest
     std::string app_id;
     std::string case_id;
     std::string inputfile;
+    std::string trace_id; // optional, omitted when empty
+    std::string codec;    // optional, compression of inputfile ("zstd"), omitted when empty
+    std::string affinity; // optional input-affinity key (e.g. a shared base file), omitted when empty
+};
+
+// Resources used by the simulator process of a case: wall time, the rusage of the reaped child and
+// its /proc/<pid>/io character counts (reads of memory-mapped input are not included).
+struct ResourceUsage
+{
+    std::uint64_t wall_us = 0;
+    std::uint64_t user_us = 0;
+    std::uint64_t sys_us = 0;
+    std::uint64_t max_rss_kb = 0;
+    std::uint64_t read_bytes = 0;
+    std::uint64_t write_bytes = 0;
+    std::uint64_t voluntary_ctxsw = 0;
+    std::uint64_t involuntary_ctxsw = 0;
 };
 
 struct SimulationResult
@@ -20,8 +42,74 @@ struct SimulationResult
     std::string app_id;
     std::string case_id;
     std::string outputfile;
+    bool success = true;
+    std::string trace_id;
+    std::string codec; // compression of outputfile, empty when plain
+    std::optional<ResourceUsage> usage; // absent when the simulator did not run, or from older servers
+};
+
+// Hands the output of case `from` to case `to` as the file `inputfile`, relative to the case
+// directory of `to`; an empty inputfile stands for the inputfile of `to`.
+struct DagEdge
+{
+    std::string from;
+    std::string to;
+    std::string inputfile;
+};
+
+// Cases submitted together (request manager /submit_dag); a case runs once the cases on the `from`
+// side of its edges succeeded. The app_id and trace_id of the nodes are ignored.
+struct SimulationDagRequest
+{
+    std::string app_id;
+    std::string dag_id;
+    std::string trace_id; // optional, omitted when empty
+    std::string affinity; // optional placement key of the DAG, default of its nodes; omitted when empty
+    std::vector<SimulationRequest> nodes;
+    std::vector<DagEdge> edges;
+};
+
+// Outcome of one node: "completed", "failed", or "skipped" when a parent failed.
+struct DagCaseResult
+{
+    std::string simulator;
+    std::string version;
+    std::string case_id;
+    std::string status;
+    std::string outputfile; // empty unless completed
 };
 
+// Delivered to the app's result URL once for the whole DAG; told apart from a SimulationResult by dag_id.
+struct DagResult
+{
+    std::string app_id;
+    std::string dag_id;
+    bool success = true;
+    std::string trace_id;
+    std::vector<DagCaseResult> cases;
+};
+
+// Body of the registration the app sends at start-up (/ndt/app_register); answered with {"app_id": <int>}.
+struct AppRegistration
+{
+    std::string app_name;
+    std::string simulation_completed_url;
+};
+
+void to_json(json &j, const AppRegistration &reg)
+{
+    j = json{
+        {"app_name"                , reg.app_name},
+        {"simulation_completed_url", reg.simulation_completed_url},
+    };
+}
+
+void from_json(const json &j, AppRegistration &reg)
+{
+    j.at("app_name").get_to(reg.app_name);
+    j.at("simulation_completed_url").get_to(reg.simulation_completed_url);
+}
+
 void to_json(json &j, const SimulationRequest &task)
 {
     j = json{
@@ -31,6 +119,36 @@ void to_json(json &j, const SimulationRequest &task)
         {"case_id"  , task.case_id},
         {"inputfile"  , task.inputfile},
     };
+    if (!task.trace_id.empty())
+        j["trace_id"] = task.trace_id;
+    if (!task.codec.empty())
+        j["codec"] = task.codec;
+    if (!task.affinity.empty())
+        j["affinity"] = task.affinity;
+}
+
+void from_json(const json &j, SimulationRequest &task)
+{
+    j.at("simulator").get_to(task.simulator);
+    j.at("version").get_to(task.version);
+    j.at("app_id").get_to(task.app_id);
+    j.at("case_id").get_to(task.case_id);
+    j.at("inputfile").get_to(task.inputfile);
+    task.trace_id = j.value("trace_id", "");
+    task.codec = j.value("codec", "");
+    task.affinity = j.value("affinity", "");
+}
+
+void from_json(const json &j, ResourceUsage &usage)
+{
+    usage.wall_us = j.value("wall_us", std::uint64_t(0));
+    usage.user_us = j.value("user_us", std::uint64_t(0));
+    usage.sys_us = j.value("sys_us", std::uint64_t(0));
+    usage.max_rss_kb = j.value("max_rss_kb", std::uint64_t(0));
+    usage.read_bytes = j.value("read_bytes", std::uint64_t(0));
+    usage.write_bytes = j.value("write_bytes", std::uint64_t(0));
+    usage.voluntary_ctxsw = j.value("voluntary_ctxsw", std::uint64_t(0));
+    usage.involuntary_ctxsw = j.value("involuntary_ctxsw", std::uint64_t(0));
 }
 
 void from_json(const json &j, SimulationResult &result)
@@ -40,4 +158,113 @@ void from_json(const json &j, SimulationResult &result)
     j.at("app_id").get_to(result.app_id);
     j.at("case_id").get_to(result.case_id);
     j.at("outputfile").get_to(result.outputfile);
+    if (j.contains("success"))
+        j.at("success").get_to(result.success);
+    result.trace_id = j.value("trace_id", "");
+    result.codec = j.value("codec", "");
+    if (j.contains("usage"))
+        result.usage = j.at("usage").get<ResourceUsage>();
+}
+
+void to_json(json &j, const DagEdge &edge)
+{
+    j = json{
+        {"from", edge.from},
+        {"to"  , edge.to},
+    };
+    if (!edge.inputfile.empty())
+        j["inputfile"] = edge.inputfile;
+}
+
+void to_json(json &j, const SimulationDagRequest &dag)
+{
+    json nodes = json::array();
+    for (auto &node : dag.nodes)
+    {
+        json n = node;
+        n.erase("app_id");
+        n.erase("trace_id");
+        nodes.push_back(std::move(n));
+    }
+    j = json{
+        {"app_id", dag.app_id},
+        {"dag_id", dag.dag_id},
+        {"nodes" , std::move(nodes)},
+        {"edges" , dag.edges},
+    };
+    if (!dag.trace_id.empty())
+        j["trace_id"] = dag.trace_id;
+    if (!dag.affinity.empty())
+        j["affinity"] = dag.affinity;
+}
+
+void from_json(const json &j, DagCaseResult &result)
+{
+    j.at("simulator").get_to(result.simulator);
+    j.at("version").get_to(result.version);
+    j.at("case_id").get_to(result.case_id);
+    j.at("status").get_to(result.status);
+    result.outputfile = j.value("outputfile", "");
+}
+
+void from_json(const json &j, DagResult &result)
+{
+    j.at("app_id").get_to(result.app_id);
+    j.at("dag_id").get_to(result.dag_id);
+    j.at("success").get_to(result.success);
+    j.at("cases").get_to(result.cases);
+    result.trace_id = j.value("trace_id", "");
+}
+
+void to_wire(std::string &out, const SimulationRequest &task)
+{
+    wire::Writer w(out, wire::Kind::Request);
+    w.put_string(task.simulator);
+    w.put_string(task.version);
+    w.put_string(task.app_id);
+    w.put_string(task.case_id);
+    w.put_string(task.inputfile);
+    w.put_string(task.trace_id);
+    w.put_string(task.codec);
+    w.put_string(task.affinity);
+    w.finish();
+}
+
+void from_wire(std::string_view in, SimulationRequest &task)
+{
+    wire::Reader r(in, wire::Kind::Request);
+    task.simulator = r.get_string();
+    task.version   = r.get_string();
+    task.app_id    = r.get_string();
+    task.case_id   = r.get_string();
+    task.inputfile = r.get_string();
+    if (!r.at_end())
+        task.trace_id = r.get_string();
+    if (!r.at_end())
+        task.codec = r.get_string();
+    if (!r.at_end())
+        task.affinity = r.get_string();
+}
+
+void from_wire(std::string_view in, SimulationResult &result)
+{
+    wire::Reader r(in, wire::Kind::Result);
+    result.simulator  = r.get_string();
+    result.version    = r.get_string();
+    result.app_id     = r.get_string();
+    result.case_id    = r.get_string();
+    result.outputfile = r.get_string();
+    result.success    = r.get_bool();
+    if (!r.at_end())
+        result.trace_id = r.get_string();
+    if (!r.at_end())
+        result.codec = r.get_string();
+    if (!r.at_end() && r.get_bool())
+    {
+        ResourceUsage u;
+        for (std::uint64_t *v : {&u.wall_us, &u.user_us, &u.sys_us, &u.max_rss_kb, &u.read_bytes, &u.write_bytes,
+                                 &u.voluntary_ctxsw, &u.involuntary_ctxsw})
+            *v = r.get_u64();
+        result.usage = u;
+    }
 }
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include "settings/sim_server.hpp"
+#include "utils/json_codec.hpp"
+#include "utils/wire.hpp"
 
 using json = nlohmann::json;
 
@@ -14,6 +20,23 @@ struct SimulationTask
     std::string case_id;
     std::string inputfile;
     std::string outputfile;
+    std::string trace_id; // optional
+    std::string codec;    // optional, compression of inputfile ("zstd")
+    std::string affinity; // optional input-affinity key: tasks sharing it run on the same NUMA node
+};
+
+// Resources used by the simulator process of a case: wall time, the rusage of the reaped child and
+// its /proc/<pid>/io character counts (reads of memory-mapped input are not included).
+struct ResourceUsage
+{
+    std::uint64_t wall_us = 0;
+    std::uint64_t user_us = 0;
+    std::uint64_t sys_us = 0;
+    std::uint64_t max_rss_kb = 0;
+    std::uint64_t read_bytes = 0;
+    std::uint64_t write_bytes = 0;
+    std::uint64_t voluntary_ctxsw = 0;
+    std::uint64_t involuntary_ctxsw = 0;
 };
 
 struct SimulationResult
@@ -24,6 +47,49 @@ struct SimulationResult
     std::string case_id;
     std::string outputfile;
     bool success;
+    std::string trace_id; // optional, omitted from JSON when empty
+    std::string codec;    // compression of outputfile, omitted from JSON when empty
+    std::optional<ResourceUsage> usage; // omitted when the simulator did not run
+};
+
+// Hands the output of case `from` to case `to` as the file `inputfile`, relative to the case
+// directory of `to`; an empty inputfile stands for the inputfile of `to`.
+struct DagEdge
+{
+    std::string from;
+    std::string to;
+    std::string inputfile;
+};
+
+// Cases that run once all their parents (the `from` side of their edges) succeeded. The nodes share
+// the app_id and trace_id of the DAG, and its affinity unless they have their own.
+struct SimulationDag
+{
+    std::string app_id;
+    std::string dag_id;
+    std::string trace_id; // optional
+    std::vector<SimulationTask> nodes;
+    std::vector<DagEdge> edges;
+};
+
+// Outcome of one node: "completed", "failed", or "skipped" when a parent failed.
+struct DagCaseResult
+{
+    std::string simulator;
+    std::string version;
+    std::string case_id;
+    std::string status;
+    std::string outputfile; // omitted from JSON unless completed
+};
+
+// The single result of a DAG, sent once every node completed, failed or was skipped.
+struct DagResult
+{
+    std::string app_id;
+    std::string dag_id;
+    bool success;         // every node completed
+    std::string trace_id; // optional, omitted from JSON when empty
+    std::vector<DagCaseResult> cases;
 };
 
 void from_json(const json &j, SimulationTask &task)
@@ -33,10 +99,27 @@ void from_json(const json &j, SimulationTask &task)
     j.at("app_id")   .get_to(task.app_id);
     j.at("case_id")  .get_to(task.case_id);
     j.at("inputfile").get_to(task.inputfile);
+    task.trace_id = j.value("trace_id", "");
+    task.codec = j.value("codec", "");
+    task.affinity = j.value("affinity", "");
     task.inputfile  = abs_input_file_path(task.simulator, task.version, task.app_id, task.case_id, task.inputfile);
     task.outputfile = abs_output_file_path(task.simulator, task.version, task.app_id, task.case_id);
 }
 
+void to_json(json &j, const ResourceUsage &usage)
+{
+    j = json{
+        {"wall_us"          , usage.wall_us},
+        {"user_us"          , usage.user_us},
+        {"sys_us"           , usage.sys_us},
+        {"max_rss_kb"       , usage.max_rss_kb},
+        {"read_bytes"       , usage.read_bytes},
+        {"write_bytes"      , usage.write_bytes},
+        {"voluntary_ctxsw"  , usage.voluntary_ctxsw},
+        {"involuntary_ctxsw", usage.involuntary_ctxsw},
+    };
+}
+
 void to_json(json &j, const SimulationResult &result)
 {
     j = json{
@@ -47,4 +130,247 @@ void to_json(json &j, const SimulationResult &result)
         {"outputfile", result.outputfile},
         {"success"   , result.success}
     };
+    if (!result.trace_id.empty())
+        j["trace_id"] = result.trace_id;
+    if (!result.codec.empty())
+        j["codec"] = result.codec;
+    if (result.usage)
+        j["usage"] = *result.usage;
+}
+
+void from_json(const json &j, SimulationDag &dag)
+{
+    j.at("app_id").get_to(dag.app_id);
+    j.at("dag_id").get_to(dag.dag_id);
+    dag.trace_id = j.value("trace_id", "");
+    for (json node : j.at("nodes"))
+    {
+        node["app_id"] = dag.app_id;
+        node["trace_id"] = dag.trace_id;
+        if (!node.contains("affinity") && j.contains("affinity"))
+            node["affinity"] = j["affinity"];
+        dag.nodes.push_back(node.get<SimulationTask>());
+    }
+    if (j.contains("edges"))
+        for (auto &edge : j.at("edges"))
+            dag.edges.push_back({edge.at("from").get<std::string>(), edge.at("to").get<std::string>(),
+                                 edge.value("inputfile", "")});
+}
+
+void to_json(json &j, const DagCaseResult &result)
+{
+    j = json{
+        {"simulator", result.simulator},
+        {"version"  , result.version},
+        {"case_id"  , result.case_id},
+        {"status"   , result.status}
+    };
+    if (!result.outputfile.empty())
+        j["outputfile"] = result.outputfile;
+}
+
+void to_json(json &j, const DagResult &result)
+{
+    j = json{
+        {"app_id" , result.app_id},
+        {"dag_id" , result.dag_id},
+        {"success", result.success},
+        {"cases"  , result.cases}
+    };
+    if (!result.trace_id.empty())
+        j["trace_id"] = result.trace_id;
+}
+
+void from_wire(std::string_view in, SimulationTask &task)
+{
+    wire::Reader r(in, wire::Kind::Request);
+    task.simulator = r.get_string();
+    task.version   = r.get_string();
+    task.app_id    = r.get_string();
+    task.case_id   = r.get_string();
+    task.inputfile = r.get_string();
+    if (!r.at_end())
+        task.trace_id = r.get_string();
+    if (!r.at_end())
+        task.codec = r.get_string();
+    if (!r.at_end())
+        task.affinity = r.get_string();
+    task.inputfile  = abs_input_file_path(task.simulator, task.version, task.app_id, task.case_id, task.inputfile);
+    task.outputfile = abs_output_file_path(task.simulator, task.version, task.app_id, task.case_id);
+}
+
+void to_wire(std::string &out, const SimulationResult &result)
+{
+    wire::Writer w(out, wire::Kind::Result);
+    w.put_string(result.simulator);
+    w.put_string(result.version);
+    w.put_string(result.app_id);
+    w.put_string(result.case_id);
+    w.put_string(result.outputfile);
+    w.put_bool(result.success);
+    w.put_string(result.trace_id);
+    w.put_string(result.codec);
+    w.put_bool(result.usage.has_value());
+    if (result.usage)
+    {
+        const auto &u = *result.usage;
+        for (std::uint64_t v : {u.wall_us, u.user_us, u.sys_us, u.max_rss_kb, u.read_bytes, u.write_bytes,
+                                u.voluntary_ctxsw, u.involuntary_ctxsw})
+            w.put_u64(v);
+    }
+    w.finish();
+}
+
+// Allocation-free fast path for the JSON task body. Fields are string_views into the request
+// buffer and the absolute paths are built in fixed-capacity storage, so no DOM is created.
+struct SimulationTaskView
+{
+    std::string_view simulator;
+    std::string_view version;
+    std::string_view app_id;
+    std::string_view case_id;
+    std::string_view inputfile; // as sent, relative to the case directory
+    std::string_view trace_id;
+    std::string_view codec;
+    std::string_view affinity;
+    json_codec::FixedString<4096> abs_inputfile;
+    json_codec::FixedString<4096> abs_outputfile;
+};
+
+// Returns false when the body needs the general parser (escapes, non-ASCII, missing fields,
+// unexpected value types); the caller then uses from_json, which also reports the error.
+bool parse_task(std::string_view body, SimulationTaskView &view)
+{
+    bool seen[5] = {};
+    view.trace_id = {};
+    view.codec = {};
+    view.affinity = {};
+    std::string_view key, value;
+    json_codec::FlatObjectReader reader(body);
+    for (;;)
+    {
+        json_codec::Token token = reader.next(key, value);
+        if (token == json_codec::Token::End)
+            break;
+        if (token == json_codec::Token::Unsupported)
+            return false;
+
+        std::string_view *field = nullptr;
+        int index = -1;
+        if      (key == "simulator") { field = &view.simulator; index = 0; }
+        else if (key == "version")   { field = &view.version;   index = 1; }
+        else if (key == "app_id")    { field = &view.app_id;    index = 2; }
+        else if (key == "case_id")   { field = &view.case_id;   index = 3; }
+        else if (key == "inputfile") { field = &view.inputfile; index = 4; }
+        else if (key == "trace_id")  { field = &view.trace_id; }
+        else if (key == "codec")     { field = &view.codec; }
+        else if (key == "affinity")  { field = &view.affinity; }
+        else
+            continue; // unknown members are ignored, as in from_json
+        if (token != json_codec::Token::String)
+            return false;
+        *field = value;
+        if (index >= 0)
+            seen[index] = true;
+    }
+    for (bool s : seen)
+        if (!s)
+            return false;
+
+    // Same layout as abs_input_file_path / abs_output_file_path.
+    case_layout::ShardPrefix shard(view.case_id, case_dir_layout);
+    for (auto *path : {&view.abs_inputfile, &view.abs_outputfile})
+    {
+        path->clear();
+        if (!path->append(case_root.native()) || !path->append_path(view.app_id) ||
+            !path->append_path(view.simulator) || !path->append_path(view.version) ||
+            (!shard.view().empty() && !path->append_path(shard.view())) ||
+            !path->append_path(view.case_id))
+            return false;
+    }
+    return view.abs_inputfile.append_path(view.inputfile) &&
+           view.abs_outputfile.append_path(output_filename.native());
+}
+
+void assign_task(const SimulationTaskView &view, SimulationTask &task)
+{
+    task.simulator.assign(view.simulator);
+    task.version.assign(view.version);
+    task.app_id.assign(view.app_id);
+    task.case_id.assign(view.case_id);
+    task.inputfile.assign(view.abs_inputfile.view());
+    task.outputfile.assign(view.abs_outputfile.view());
+    task.trace_id.assign(view.trace_id);
+    task.codec.assign(view.codec);
+    task.affinity.assign(view.affinity);
+}
+
+// Compat reader: a sweep written before case directories were sharded keeps its cases in the legacy
+// layout, so when the input is only found there, run the case there.
+void apply_legacy_layout_fallback(SimulationTask &task)
+{
+    if (!case_layout_legacy_fallback || case_dir_layout.levels == 0)
+        return;
+    std::error_code ec;
+    if (fs::exists(task.inputfile, ec))
+        return;
+    fs::path sweep = case_root / task.app_id / task.simulator / task.version;
+    fs::path relative = fs::path(task.inputfile).lexically_relative(case_layout::case_dir(sweep, task.case_id, case_dir_layout));
+    fs::path legacy = case_layout::legacy_case_dir(sweep, task.case_id);
+    if (relative.empty() || !fs::exists(legacy / relative, ec))
+        return;
+    task.inputfile = (legacy / relative).string();
+    task.outputfile = (legacy / output_filename).string();
+}
+
+// Appends exactly what json(result).dump() produces (nlohmann orders keys alphabetically),
+// without building a DOM. Falls back to nlohmann for strings with non-ASCII bytes.
+void write_result(std::string &out, const SimulationResult &result)
+{
+    std::size_t start = out.size();
+    bool ok = true;
+    out += "{\"app_id\":";
+    ok = ok && json_codec::append_string(out, result.app_id);
+    out += ",\"case_id\":";
+    ok = ok && json_codec::append_string(out, result.case_id);
+    if (!result.codec.empty())
+    {
+        out += ",\"codec\":";
+        ok = ok && json_codec::append_string(out, result.codec);
+    }
+    out += ",\"outputfile\":";
+    ok = ok && json_codec::append_string(out, result.outputfile);
+    out += ",\"simulator\":";
+    ok = ok && json_codec::append_string(out, result.simulator);
+    out += result.success ? ",\"success\":true" : ",\"success\":false";
+    if (!result.trace_id.empty())
+    {
+        out += ",\"trace_id\":";
+        ok = ok && json_codec::append_string(out, result.trace_id);
+    }
+    if (result.usage)
+    {
+        const auto &u = *result.usage;
+        const std::pair<const char *, std::uint64_t> fields[] = {
+            {"{\"involuntary_ctxsw\":", u.involuntary_ctxsw}, {",\"max_rss_kb\":", u.max_rss_kb},
+            {",\"read_bytes\":", u.read_bytes}, {",\"sys_us\":", u.sys_us}, {",\"user_us\":", u.user_us},
+            {",\"voluntary_ctxsw\":", u.voluntary_ctxsw}, {",\"wall_us\":", u.wall_us},
+            {",\"write_bytes\":", u.write_bytes},
+        };
+        out += ",\"usage\":";
+        for (auto &[key, value] : fields)
+        {
+            out += key;
+            json_codec::append_uint(out, value);
+        }
+        out += '}';
+    }
+    out += ",\"version\":";
+    ok = ok && json_codec::append_string(out, result.version);
+    out += '}';
+    if (!ok)
+    {
+        out.resize(start);
+        out += json(result).dump();
+    }
 }
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "utils/case_layout.hpp"
+
+// Where results of a registered app are delivered.
+struct AppRoute
+{
+    std::string app_id;
+    std::string app_name;
+    std::string host;
+    std::string port;
+    std::string target;
+    mutable std::atomic<std::int64_t> last_seen_ms{0};
+};
+
+// Splits "http://host[:port][/target]"; returns false for anything else.
+inline bool parse_http_url(std::string_view url, std::string &host, std::string &port, std::string &target)
+{
+    constexpr std::string_view scheme = "http://";
+    if (url.substr(0, scheme.size()) != scheme)
+        return false;
+    url.remove_prefix(scheme.size());
+    auto slash = url.find('/');
+    auto authority = url.substr(0, slash);
+    target = slash == std::string_view::npos ? "/" : std::string(url.substr(slash));
+    auto colon = authority.rfind(':');
+    if (colon == std::string_view::npos)
+    {
+        host = authority;
+        port = "80";
+    }
+    else
+    {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    return !host.empty() && !port.empty() && port.find_first_not_of("0123456789") == std::string::npos;
+}
+
+// app_id -> AppRoute, read on every forwarded result and written only by registrations and expiry.
+//
+// Readers never lock: the table is an immutable snapshot published through an atomic pointer, and
+// writers (serialized by a mutex) copy it, modify the copy and swap it in. Replaced snapshots are
+// retired and freed by reclaim() once no reader is inside find(); routes themselves are shared, so a
+// route handed out by find() stays valid after its snapshot is gone.
+class AppRoutingTable
+{
+public:
+    using RoutePtr = std::shared_ptr<const AppRoute>;
+
+    AppRoutingTable() : current_(new Table()) {}
+
+    ~AppRoutingTable()
+    {
+        delete current_.load();
+        for (auto *t : retired_)
+            delete t;
+    }
+
+    AppRoutingTable(const AppRoutingTable &) = delete;
+    AppRoutingTable &operator=(const AppRoutingTable &) = delete;
+
+    static std::int64_t now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Lock-free lookup; refreshes the route's last-seen time. Returns nullptr for unknown apps.
+    RoutePtr find(const std::string &app_id) const
+    {
+        readers_.fetch_add(1);
+        const Table *table = current_.load();
+        RoutePtr route;
+        auto it = table->find(app_id);
+        if (it != table->end())
+            route = it->second;
+        readers_.fetch_sub(1);
+
+        if (route)
+            route->last_seen_ms.store(now_ms(), std::memory_order_relaxed);
+        return route;
+    }
+
+    // Registers an app, or refreshes it when the same name registers again with the same URL. The id is
+    // derived from the name and URL rather than counted, so an app keeps its id across restarts of
+    // either side and an id issued before a restart never comes back naming another app. Ids fit in
+    // a positive int, which is how apps read them. Returns the app's id.
+    std::string add(const std::string &app_name, const std::string &host, const std::string &port, const std::string &target)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Table *table = current_.load();
+        std::uint64_t n = stable_id(app_name, host, port, target);
+        for (;; n = n % max_id + 1)
+        {
+            auto it = table->find(std::to_string(n));
+            if (it == table->end())
+                break;
+            const AppRoute &route = *it->second;
+            if (route.app_name == app_name && route.host == host && route.port == port && route.target == target)
+            {
+                route.last_seen_ms.store(now_ms(), std::memory_order_relaxed);
+                return it->first;
+            }
+            // a hash collision with another app: take the next free id
+        }
+
+        auto route = std::make_shared<AppRoute>();
+        route->app_id = std::to_string(n);
+        route->app_name = app_name;
+        route->host = host;
+        route->port = port;
+        route->target = target;
+        route->last_seen_ms.store(now_ms(), std::memory_order_relaxed);
+
+        auto *next = new Table(*table);
+        next->emplace(route->app_id, route);
+        publish(next);
+        return route->app_id;
+    }
+
+    // Drops routes not seen for longer than ttl_ms, except those for which busy(app_id) is true, and
+    // frees retired snapshots; returns the dropped ids.
+    template <class Busy>
+    std::vector<std::string> expire(std::int64_t ttl_ms, Busy &&busy)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        std::vector<std::string> expired;
+        const Table *table = current_.load();
+        const auto now = now_ms();
+        for (auto &[id, route] : *table)
+            if (now - route->last_seen_ms.load(std::memory_order_relaxed) > ttl_ms && !busy(id))
+                expired.push_back(id);
+
+        if (!expired.empty())
+        {
+            auto *next = new Table(*table);
+            for (auto &id : expired)
+                next->erase(id);
+            publish(next);
+        }
+        reclaim();
+        return expired;
+    }
+
+    std::size_t size() const
+    {
+        readers_.fetch_add(1);
+        std::size_t n = current_.load()->size();
+        readers_.fetch_sub(1);
+        return n;
+    }
+
+private:
+    using Table = std::unordered_map<std::string, RoutePtr>;
+
+    std::atomic<const Table *> current_;
+    mutable std::atomic<std::size_t> readers_{0};
+    std::mutex write_mutex_;
+    std::vector<const Table *> retired_;
+
+    static constexpr std::uint64_t max_id = 2147483647; // INT_MAX
+
+    static std::uint64_t stable_id(const std::string &app_name, const std::string &host, const std::string &port, const std::string &target)
+    {
+        return case_layout::hash(app_name + '\n' + host + ':' + port + target) % max_id + 1;
+    }
+
+    // Called with write_mutex_ held.
+    void publish(const Table *next)
+    {
+        retired_.push_back(current_.exchange(next));
+        reclaim();
+    }
+
+    // A reader that could still see a retired snapshot loaded it before the exchange in publish(),
+    // so once the reader count is observed at zero afterwards, every retired snapshot is unreachable.
+    // Under constant read traffic the check simply succeeds on a later call.
+    void reclaim()
+    {
+        if (retired_.empty() || readers_.load() != 0)
+            return;
+        for (auto *t : retired_)
+            delete t;
+        retired_.clear();
+    }
+};
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// State of every case the request manager has seen, for apps that reconcile by polling instead of
+// relying on each result callback. Sized for millions of cases:
+//   - app ids and simulator/version pairs are interned, case ids live in one character arena;
+//   - a case is a 32-byte Record, found through an open-addressing table of 4-byte slots;
+//   - every update gets a sequence number and is appended to its app's change log and to the log
+//     of its app and new status, so a query is a binary search plus a forward scan. Entries made
+//     stale by later updates are skipped and compacted away once they are the majority.
+// About 80 bytes per case of payload; some 160 bytes resident at two million cases once vector
+// growth is counted. Thread-safe.
+//
+// Case ids are unique per app; a later submission of the same case id overwrites its state. Ids
+// longer than max_case_id_size are not indexed.
+class CaseIndex
+{
+public:
+    enum class Status : std::uint8_t { Submitted, Queued, Rejected, Completed, Failed, Skipped };
+    static constexpr std::size_t status_count = 6;
+    static constexpr std::size_t max_case_id_size = UINT16_MAX;
+
+    static const char *status_name(Status status)
+    {
+        static const char *names[status_count] = {"submitted", "queued", "rejected", "completed", "failed", "skipped"};
+        return names[static_cast<std::size_t>(status)];
+    }
+
+    static bool parse_status(std::string_view name, Status &status)
+    {
+        for (std::size_t i = 0; i < status_count; ++i)
+            if (name == status_name(static_cast<Status>(i)))
+            {
+                status = static_cast<Status>(i);
+                return true;
+            }
+        return false;
+    }
+
+    struct Case
+    {
+        std::string case_id;
+        std::string simulator_version; // "<simulator>/<version>"
+        Status status;
+        std::uint32_t updated;              // unix seconds
+        std::uint64_t seq;
+    };
+
+    struct Query
+    {
+        std::string_view app_id;
+        bool filter_status = false;
+        Status status = Status::Submitted;
+        std::uint32_t since = 0;  // only cases updated at or after this unix time
+        std::uint64_t cursor = 0; // only updates after this sequence number
+        std::size_t limit = 1000;
+    };
+
+    // Records the new status of a case; false if its id is too long to be indexed. Thread-safe.
+    bool update(std::string_view app_id, std::string_view case_id, std::string_view simulator,
+                std::string_view version, Status status, std::uint32_t now = static_cast<std::uint32_t>(std::time(nullptr)))
+    {
+        if (case_id.size() > max_case_id_size)
+            return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uint32_t app = intern(apps_, app_names_, app_id);
+        std::string sim_version;
+        sim_version.reserve(simulator.size() + 1 + version.size());
+        sim_version.append(simulator).append("/").append(version);
+
+        std::uint32_t index = find(app, case_id);
+        bool added = index == npos;
+        if (added)
+        {
+            index = static_cast<std::uint32_t>(records_.size());
+            Record r{};
+            r.app = app;
+            r.case_offset = static_cast<std::uint32_t>(arena_.size());
+            r.case_size = static_cast<std::uint16_t>(case_id.size());
+            arena_.append(case_id);
+            records_.push_back(r);
+            insert_slot(index);
+        }
+        Record &r = records_[index];
+        if (added || !simulator.empty() || !version.empty())
+            r.sim_version = intern(sim_versions_, sim_version_names_, sim_version);
+        r.status = static_cast<std::uint8_t>(status);
+        r.updated = now;
+        r.seq = ++seq_;
+
+        if (logs_.size() <= app)
+            logs_.resize(app + 1);
+        AppLogs &logs = logs_[app];
+        logs.all.push_back({r.seq, index});
+        logs.by_status[r.status].push_back({r.seq, index});
+        if (!added)
+            logs.stale += 2; // the previous entries of this case in both logs
+        if (logs.stale > logs.all.size() + 1024)
+            compact(logs);
+        return true;
+    }
+
+    // Cases of one app in update order. next_cursor continues the query; more is set if the limit
+    // cut it short. Thread-safe.
+    std::vector<Case> query(const Query &q, std::uint64_t &next_cursor, bool &more)
+    {
+        std::vector<Case> out;
+        more = false;
+        next_cursor = q.cursor;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto app_it = apps_.find(std::string(q.app_id));
+        if (app_it == apps_.end() || app_it->second >= logs_.size())
+            return out;
+        const AppLogs &logs = logs_[app_it->second];
+        const auto &log = q.filter_status ? logs.by_status[static_cast<std::size_t>(q.status)] : logs.all;
+
+        auto it = std::upper_bound(log.begin(), log.end(), q.cursor,
+                                   [](std::uint64_t seq, const LogEntry &e) { return seq < e.seq; });
+        for (; it != log.end(); ++it)
+        {
+            const Record &r = records_[it->record];
+            if (r.seq != it->seq)
+                continue; // superseded by a later update
+            if (r.updated < q.since)
+                continue;
+            if (out.size() == q.limit)
+            {
+                more = true;
+                break;
+            }
+            out.push_back({std::string(case_id_of(r)), sim_version_names_[r.sim_version], static_cast<Status>(r.status), r.updated, r.seq});
+            next_cursor = r.seq;
+        }
+        return out;
+    }
+
+    // Whether any case of the app is still submitted or queued, i.e. has a result to come. Thread-safe.
+    bool outstanding(std::string_view app_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto app_it = apps_.find(std::string(app_id));
+        if (app_it == apps_.end() || app_it->second >= logs_.size())
+            return false;
+        const AppLogs &logs = logs_[app_it->second];
+        for (Status status : {Status::Submitted, Status::Queued})
+        {
+            const auto &log = logs.by_status[static_cast<std::size_t>(status)];
+            for (auto it = log.rbegin(); it != log.rend(); ++it) // live entries are mostly the recent ones
+                if (records_[it->record].seq == it->seq)
+                    return true;
+        }
+        return false;
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_.size();
+    }
+
+    // Forgets cases not updated for ttl_seconds by rebuilding the index. Thread-safe; O(cases).
+    std::size_t expire(std::uint32_t ttl_seconds, std::uint32_t now = static_cast<std::uint32_t>(std::time(nullptr)))
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uint32_t cutoff = now > ttl_seconds ? now - ttl_seconds : 0;
+        std::size_t expired = 0;
+        for (auto &r : records_)
+            expired += r.updated < cutoff;
+        if (expired == 0)
+            return 0;
+
+        std::vector<Record> records;
+        std::string arena;
+        records.reserve(records_.size() - expired);
+        for (auto &r : records_)
+        {
+            if (r.updated < cutoff)
+                continue;
+            Record copy = r;
+            copy.case_offset = static_cast<std::uint32_t>(arena.size());
+            arena.append(arena_, r.case_offset, r.case_size);
+            records.push_back(copy);
+        }
+        records_ = std::move(records);
+        arena_ = std::move(arena);
+        arena_.shrink_to_fit();
+
+        slots_.assign(slots_.size(), empty_slot);
+        for (std::uint32_t i = 0; i < records_.size(); ++i)
+            insert_slot(i);
+        for (auto &logs : logs_)
+            logs = AppLogs{};
+        std::vector<std::uint32_t> order(records_.size());
+        for (std::uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](auto a, auto b) { return records_[a].seq < records_[b].seq; });
+        for (auto i : order)
+        {
+            const Record &r = records_[i];
+            logs_[r.app].all.push_back({r.seq, i});
+            logs_[r.app].by_status[r.status].push_back({r.seq, i});
+        }
+        return expired;
+    }
+
+private:
+    static constexpr std::uint32_t npos = UINT32_MAX;
+    static constexpr std::uint32_t empty_slot = UINT32_MAX;
+
+    struct Record
+    {
+        std::uint64_t seq;
+        std::uint32_t updated;
+        std::uint32_t app;
+        std::uint32_t sim_version;
+        std::uint32_t case_offset;
+        std::uint16_t case_size;
+        std::uint8_t status;
+    };
+    static_assert(sizeof(Record) == 32);
+
+    struct LogEntry
+    {
+        std::uint64_t seq;
+        std::uint32_t record;
+    };
+
+    struct AppLogs
+    {
+        std::vector<LogEntry> all;
+        std::vector<LogEntry> by_status[status_count];
+        std::size_t stale = 0;
+    };
+
+    std::mutex mutex_;
+    std::uint64_t seq_ = 0;
+    std::unordered_map<std::string, std::uint32_t> apps_, sim_versions_;
+    std::vector<std::string> app_names_, sim_version_names_;
+    std::string arena_;                 // case ids, back to back
+    std::vector<Record> records_;
+    std::vector<std::uint32_t> slots_;  // record index per slot, linear probing, at most half full
+    std::vector<AppLogs> logs_;         // by interned app
+
+    static std::uint32_t intern(std::unordered_map<std::string, std::uint32_t> &ids, std::vector<std::string> &names,
+                                std::string_view value)
+    {
+        auto [it, inserted] = ids.try_emplace(std::string(value), static_cast<std::uint32_t>(names.size()));
+        if (inserted)
+            names.push_back(it->first);
+        return it->second;
+    }
+
+    static std::size_t hash(std::uint32_t app, std::string_view case_id)
+    {
+        return std::hash<std::string_view>{}(case_id) ^ (std::size_t(app) * 0x9e3779b97f4a7c15ull);
+    }
+
+    std::string_view case_id_of(const Record &r) const
+    {
+        return std::string_view(arena_).substr(r.case_offset, r.case_size);
+    }
+
+    std::uint32_t find(std::uint32_t app, std::string_view case_id) const
+    {
+        if (slots_.empty())
+            return npos;
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = hash(app, case_id) & mask;; i = (i + 1) & mask)
+        {
+            std::uint32_t index = slots_[i];
+            if (index == empty_slot)
+                return npos;
+            const Record &r = records_[index];
+            if (r.app == app && case_id_of(r) == case_id)
+                return index;
+        }
+    }
+
+    void insert_slot(std::uint32_t index)
+    {
+        if (2 * records_.size() > slots_.size())
+        {
+            std::vector<std::uint32_t> old;
+            old.swap(slots_);
+            slots_.assign(std::max<std::size_t>(1024, old.size() * 2), empty_slot);
+            for (std::uint32_t i : old)
+                if (i != empty_slot)
+                    place(i);
+        }
+        place(index);
+    }
+
+    void place(std::uint32_t index)
+    {
+        std::size_t mask = slots_.size() - 1;
+        const Record &r = records_[index];
+        std::size_t i = hash(r.app, case_id_of(r)) & mask;
+        while (slots_[i] != empty_slot)
+            i = (i + 1) & mask;
+        slots_[i] = index;
+    }
+
+    void compact(AppLogs &logs)
+    {
+        auto superseded = [this](const LogEntry &e) { return records_[e.record].seq != e.seq; };
+        logs.all.erase(std::remove_if(logs.all.begin(), logs.all.end(), superseded), logs.all.end());
+        for (auto &log : logs.by_status)
+            log.erase(std::remove_if(log.begin(), log.end(), superseded), log.end());
+        logs.stale = 0;
+    }
+};
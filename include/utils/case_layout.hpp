@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Placement of case directories below a sweep directory (<root>/<simulator>/<version>).
+//
+// Legacy layout:  <sweep>/<case_id>
+// Sharded layout: <sweep>/<h0>/<h1>/.../<case_id>, with `levels` fan-out directories named by
+// consecutive `width`-digit hex groups of a 64-bit hash of the case id. Two levels of two
+// digits spread a sweep over 65536 leaf directories, so 10^6 cases leave ~15 entries per directory.
+//
+// The app, the sim server and tools must all use the same Layout (settings/case_layout.hpp).
+namespace case_layout
+{
+
+namespace fs = std::filesystem;
+
+struct Layout
+{
+    unsigned levels = 0; // 0 is the legacy layout
+    unsigned width = 2;  // hex digits per level, 1..4
+};
+
+inline constexpr unsigned max_levels = 4;
+inline constexpr unsigned max_width = 4;
+
+inline std::uint64_t hash(std::string_view s)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    // FNV-1a barely mixes the last bytes into the high bits, and case ids usually differ only
+    // in their last characters, so finish with the 64-bit MurmurHash3 mixer.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// "ab/cd" for two levels of width 2; empty for the legacy layout. No allocation.
+class ShardPrefix
+{
+public:
+    ShardPrefix(std::string_view case_id, const Layout &layout)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        unsigned levels = layout.levels < max_levels ? layout.levels : max_levels;
+        unsigned width = layout.width < 1 ? 1 : layout.width > max_width ? max_width : layout.width;
+        std::uint64_t h = hash(case_id);
+        for (unsigned level = 0; level < levels; ++level)
+        {
+            if (level > 0)
+                data_[size_++] = '/';
+            for (unsigned i = 0; i < width; ++i)
+            {
+                data_[size_++] = digits[h >> 60];
+                h <<= 4;
+            }
+        }
+    }
+
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    char data_[max_levels * (max_width + 1)];
+    std::size_t size_ = 0;
+};
+
+inline fs::path case_dir(const fs::path &sweep_dir, std::string_view case_id, const Layout &layout)
+{
+    fs::path dir = sweep_dir;
+    ShardPrefix prefix(case_id, layout);
+    if (!prefix.view().empty())
+        dir /= prefix.view();
+    return dir / case_id;
+}
+
+inline fs::path legacy_case_dir(const fs::path &sweep_dir, std::string_view case_id)
+{
+    return sweep_dir / case_id;
+}
+
+// Compat reader for sweeps written before the layout changed: the configured location if it exists,
+// otherwise the legacy one if that exists, otherwise the configured location.
+inline fs::path locate_case_dir(const fs::path &sweep_dir, std::string_view case_id, const Layout &layout)
+{
+    fs::path dir = case_dir(sweep_dir, case_id, layout);
+    if (layout.levels == 0)
+        return dir;
+    std::error_code ec;
+    if (fs::exists(dir, ec))
+        return dir;
+    fs::path legacy = legacy_case_dir(sweep_dir, case_id);
+    return fs::exists(legacy, ec) ? legacy : dir;
+}
+
+// Whether name could be a fan-out directory of layout (width hex digits); the migration tool
+// treats such entries as already sharded.
+inline bool is_shard_name(std::string_view name, const Layout &layout)
+{
+    if (name.size() != layout.width)
+        return false;
+    for (char c : name)
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+            return false;
+    return true;
+}
+
+} // namespace case_layout
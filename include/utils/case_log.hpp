@@ -0,0 +1,232 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/strand.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Captured stdout and stderr of one simulator run. The child writes into a pipe that is drained
+// asynchronously into a ring buffer, so a chatty simulator never blocks on the sim server. The
+// ring keeps the most recent output in memory for live queries; whenever half of it is new, that
+// part is appended to a log file by the writer executor (blocking file I/O stays off the io
+// threads). The log file is rotated to <file>.1 once it reaches max_file_bytes. When the file
+// cannot keep up, the oldest unwritten output is overwritten and counted as dropped.
+class CaseLog : public std::enable_shared_from_this<CaseLog>
+{
+public:
+    CaseLog(boost::asio::io_context &ioc, std::filesystem::path file, boost::asio::any_io_executor writer,
+            std::size_t buffer_bytes, std::uintmax_t max_file_bytes)
+    : file_(std::move(file)), writer_(boost::asio::make_strand(writer)), pipe_(ioc),
+      ring_(buffer_bytes), max_file_bytes_(max_file_bytes)
+    {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) != 0)
+            throw std::system_error(errno, std::generic_category(), "pipe2");
+        pipe_.assign(fds[0]);
+        child_fd_ = fds[1];
+    }
+
+    ~CaseLog()
+    {
+        if (child_fd_ >= 0)
+            ::close(child_fd_);
+    }
+
+    // Write end for the child's stdout and stderr; valid until start().
+    int child_fd() const { return child_fd_; }
+
+    // Call once the child has been spawned. on_closed runs after the child (and anything it left
+    // running) closed its output and everything is written to the file.
+    void start(std::function<void()> on_closed = {})
+    {
+        ::close(child_fd_);
+        child_fd_ = -1;
+        on_closed_ = std::move(on_closed);
+        read();
+    }
+
+    // The last `lines` lines in the ring, all of it for 0. Thread-safe.
+    std::string tail(std::size_t lines)
+    {
+        std::string text;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            text.reserve(size_);
+            for (std::size_t i = 0; i < size_; ++i)
+                text.push_back(ring_[(begin_ + i) % ring_.size()]);
+        }
+        return std::string(tail_lines(text, lines));
+    }
+
+    // The last `lines` lines of text, all of it for 0.
+    static std::string_view tail_lines(std::string_view text, std::size_t lines)
+    {
+        if (lines == 0)
+            return text;
+        std::size_t end = text.size();
+        if (end > 0 && text[end - 1] == '\n')
+            --end; // a final newline does not start another line
+        std::size_t pos = end;
+        while (pos > 0)
+        {
+            if (text[pos - 1] == '\n' && --lines == 0)
+                break;
+            --pos;
+        }
+        return text.substr(pos);
+    }
+
+    // The last `lines` lines of a log file, including its rotated predecessor when the file alone
+    // has fewer. Empty if neither exists.
+    static std::string read_tail(const std::filesystem::path &file, std::size_t lines)
+    {
+        std::string text = read_file(rotated(file)) + read_file(file);
+        return std::string(tail_lines(text, lines));
+    }
+
+    static std::filesystem::path rotated(std::filesystem::path file)
+    {
+        return file += ".1";
+    }
+
+private:
+    std::filesystem::path file_;
+    boost::asio::strand<boost::asio::any_io_executor> writer_; // owns out_ and written_
+    boost::asio::posix::stream_descriptor pipe_;
+    int child_fd_ = -1;
+    std::function<void()> on_closed_;
+    char chunk_[4096];
+
+    std::mutex mutex_; // ring_ state, read by tail()
+    std::vector<char> ring_;
+    std::size_t begin_ = 0, size_ = 0;
+    std::size_t unwritten_ = 0;     // newest bytes of the ring not yet handed to the writer
+    std::size_t dropped_ = 0;       // overwritten before they were handed to the writer
+    std::size_t pending_ = 0;       // ring output handed to the writer and not yet written, at most ring_.size()
+
+    std::uintmax_t max_file_bytes_;
+    std::FILE *out_ = nullptr;
+    std::uintmax_t written_ = 0;
+
+    static std::string read_file(const std::filesystem::path &path)
+    {
+        std::string text;
+        if (std::FILE *in = std::fopen(path.c_str(), "rb"))
+        {
+            char buf[65536];
+            std::size_t n;
+            while ((n = std::fread(buf, 1, sizeof buf, in)) > 0)
+                text.append(buf, n);
+            std::fclose(in);
+        }
+        return text;
+    }
+
+    void read()
+    {
+        pipe_.async_read_some(boost::asio::buffer(chunk_),
+            [self = shared_from_this()](const boost::system::error_code &ec, std::size_t n)
+            {
+                self->append(std::string_view(self->chunk_, n));
+                if (!ec)
+                    self->read();
+                else
+                    self->close();
+            });
+    }
+
+    void append(std::string_view data)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (char c : data)
+        {
+            if (size_ == ring_.size())
+            {
+                begin_ = (begin_ + 1) % ring_.size();
+                --size_;
+                if (unwritten_ > size_)
+                {
+                    --unwritten_;
+                    ++dropped_;
+                }
+            }
+            ring_[(begin_ + size_) % ring_.size()] = c;
+            ++size_;
+            ++unwritten_;
+        }
+        if (unwritten_ >= ring_.size() / 2)
+            spill();
+    }
+
+    // Hands the unwritten part of the ring to the writer unless it is still busy with as much, or
+    // final is set; called with mutex_ held.
+    void spill(bool final = false)
+    {
+        if ((unwritten_ == 0 && dropped_ == 0) || (!final && pending_ + unwritten_ > ring_.size()))
+            return;
+        std::string data;
+        if (dropped_ > 0)
+            data = "\n[" + std::to_string(dropped_) + " bytes of output dropped]\n";
+        for (std::size_t i = size_ - unwritten_; i < size_; ++i)
+            data.push_back(ring_[(begin_ + i) % ring_.size()]);
+        std::size_t payload = unwritten_;
+        pending_ += payload;
+        unwritten_ = dropped_ = 0;
+        boost::asio::post(writer_, [self = shared_from_this(), data = std::move(data), payload] { self->write(data, payload); });
+    }
+
+    // payload is the part of data that came from the ring, as counted in pending_.
+    void write(const std::string &data, std::size_t payload)
+    {
+        if (max_file_bytes_ > 0 && out_ && written_ + data.size() > max_file_bytes_)
+        {
+            std::fclose(out_);
+            out_ = nullptr;
+            std::error_code ec;
+            std::filesystem::rename(file_, rotated(file_), ec);
+        }
+        if (!out_)
+        {
+            // Appends, so that a case run again after a checkpoint keeps the output of earlier runs.
+            std::error_code ec;
+            auto size = std::filesystem::file_size(file_, ec);
+            out_ = std::fopen(file_.c_str(), "ab");
+            written_ = ec ? 0 : size;
+        }
+        if (out_ && std::fwrite(data.data(), 1, data.size(), out_) == data.size())
+            written_ += data.size();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ -= std::min(pending_, payload);
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            spill(true);
+        }
+        boost::asio::post(writer_, [self = shared_from_this()]
+        {
+            if (self->out_)
+                std::fclose(self->out_);
+            self->out_ = nullptr;
+            if (self->on_closed_)
+                self->on_closed_();
+        });
+    }
+};
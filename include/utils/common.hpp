@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>
 #include "Logger.hpp"
 
@@ -29,6 +32,40 @@ int safe_system(const std::string &command)
     }
 }
 
+// Value following a command-line flag such as "--capture <file>", or fallback when absent.
+inline std::string cli_option(int argc, char *argv[], const std::string &name, const std::string &fallback = "")
+{
+    for (int i = 1; i + 1 < argc; ++i)
+        if (argv[i] == name)
+            return argv[i + 1];
+    return fallback;
+}
+
+// Path of a request target, without the query string.
+inline std::string_view target_path(std::string_view target)
+{
+    return target.substr(0, target.find('?'));
+}
+
+// Value of a query string parameter of a request target ("/cases?app_id=1&limit=10"), if present.
+// Values are not percent-decoded; the ids used here never need it.
+inline std::optional<std::string_view> query_param(std::string_view target, std::string_view name)
+{
+    auto q = target.find('?');
+    if (q == std::string_view::npos)
+        return std::nullopt;
+    std::string_view query = target.substr(q + 1);
+    for (std::size_t pos = 0; pos <= query.size();)
+    {
+        std::size_t end = std::min(query.find('&', pos), query.size());
+        std::string_view param = query.substr(pos, end - pos);
+        if (param.size() > name.size() && param.substr(0, name.size()) == name && param[name.size()] == '=')
+            return param.substr(name.size() + 1);
+        pos = end + 1;
+    }
+    return std::nullopt;
+}
+
 inline std::string error_response_body(std::string error)
 {
     return nlohmann::json{{"error", error}}.dump();
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zstd.h>
+
+// zstd compression of case files on shared storage. Whether a file is compressed is recorded as
+// the codec in SimulationRequest / SimulationTask / SimulationResult ("" = plain, "zstd"), and
+// compressed files carry the ".zst" extension. Files are processed in streaming fashion with
+// zstd's recommended buffer sizes, so memory use does not grow with the file.
+namespace compression
+{
+
+namespace fs = std::filesystem;
+
+inline const std::string zstd_codec = "zstd";
+inline const std::string zstd_extension = ".zst";
+
+struct error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct Options
+{
+    int level = ZSTD_CLEVEL_DEFAULT;
+    std::string dictionary; // raw dictionary content (zstd --train), empty for none
+};
+
+inline bool is_supported(std::string_view codec)
+{
+    return codec.empty() || codec == zstd_codec;
+}
+
+// Dictionary content for Options::dictionary; an empty path means no dictionary.
+inline std::string load_dictionary(const fs::path &path)
+{
+    if (path.empty())
+        return "";
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw error("compression: unable to open dictionary " + path.string());
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+namespace detail
+{
+
+struct FileCloser
+{
+    void operator()(std::FILE *f) const { std::fclose(f); }
+};
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+inline File open(const fs::path &path, const char *mode)
+{
+    File f(std::fopen(path.c_str(), mode));
+    if (!f)
+        throw error("compression: unable to open " + path.string());
+    return f;
+}
+
+inline void check(std::size_t rc, const char *what)
+{
+    if (ZSTD_isError(rc))
+        throw error(std::string("compression: ") + what + ": " + ZSTD_getErrorName(rc));
+}
+
+inline void write_all(std::FILE *out, const void *data, std::size_t size)
+{
+    if (size && std::fwrite(data, 1, size, out) != size)
+        throw error("compression: write failed");
+}
+
+// Feeds chunks returned by next(buffer) (an empty chunk ends the input) through the compressor into out.
+template <class NextChunk>
+void compress_stream(NextChunk next, std::FILE *out, const Options &options)
+{
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    if (!cctx)
+        throw error("compression: out of memory");
+    check(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, options.level), "set level");
+    check(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_checksumFlag, 1), "set checksum");
+    if (!options.dictionary.empty())
+        check(ZSTD_CCtx_loadDictionary(cctx.get(), options.dictionary.data(), options.dictionary.size()), "load dictionary");
+
+    std::vector<char> in_buf(ZSTD_CStreamInSize()), out_buf(ZSTD_CStreamOutSize());
+    for (;;)
+    {
+        std::string_view chunk = next(in_buf);
+        bool last = chunk.empty();
+        ZSTD_inBuffer input{chunk.data(), chunk.size(), 0};
+        std::size_t remaining;
+        do
+        {
+            ZSTD_outBuffer output{out_buf.data(), out_buf.size(), 0};
+            remaining = ZSTD_compressStream2(cctx.get(), &output, &input, last ? ZSTD_e_end : ZSTD_e_continue);
+            check(remaining, "compress");
+            write_all(out, out_buf.data(), output.pos);
+        } while (last ? remaining != 0 : input.pos != input.size);
+        if (last)
+            return;
+    }
+}
+
+// Decompresses in into sink(data, size).
+template <class Sink>
+void decompress_stream(std::FILE *in, Sink sink, const std::string &dictionary)
+{
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (!dctx)
+        throw error("compression: out of memory");
+    if (!dictionary.empty())
+        check(ZSTD_DCtx_loadDictionary(dctx.get(), dictionary.data(), dictionary.size()), "load dictionary");
+
+    std::vector<char> in_buf(ZSTD_DStreamInSize()), out_buf(ZSTD_DStreamOutSize());
+    std::size_t last_rc = 0;
+    while (std::size_t n = std::fread(in_buf.data(), 1, in_buf.size(), in))
+    {
+        ZSTD_inBuffer input{in_buf.data(), n, 0};
+        while (input.pos < input.size)
+        {
+            ZSTD_outBuffer output{out_buf.data(), out_buf.size(), 0};
+            last_rc = ZSTD_decompressStream(dctx.get(), &output, &input);
+            check(last_rc, "decompress");
+            sink(out_buf.data(), output.pos);
+        }
+    }
+    if (std::ferror(in))
+        throw error("compression: read failed");
+    if (last_rc != 0)
+        throw error("compression: truncated frame");
+}
+
+} // namespace detail
+
+// Writes data to dst as a zstd frame.
+inline void compress(std::string_view data, const fs::path &dst, const Options &options)
+{
+    auto out = detail::open(dst, "wb");
+    bool done = false;
+    detail::compress_stream([&](std::vector<char> &) {
+        std::string_view chunk = done ? std::string_view() : data;
+        done = true;
+        return chunk;
+    }, out.get(), options);
+    if (std::fflush(out.get()) != 0)
+        throw error("compression: write failed " + dst.string());
+}
+
+inline void compress_file(const fs::path &src, const fs::path &dst, const Options &options)
+{
+    auto in = detail::open(src, "rb");
+    auto out = detail::open(dst, "wb");
+    detail::compress_stream([&](std::vector<char> &buf) {
+        std::size_t n = std::fread(buf.data(), 1, buf.size(), in.get());
+        if (n == 0 && std::ferror(in.get()))
+            throw error("compression: read failed " + src.string());
+        return std::string_view(buf.data(), n);
+    }, out.get(), options);
+    if (std::fflush(out.get()) != 0)
+        throw error("compression: write failed " + dst.string());
+}
+
+inline void decompress_file(const fs::path &src, const fs::path &dst, const std::string &dictionary = "")
+{
+    auto in = detail::open(src, "rb");
+    auto out = detail::open(dst, "wb");
+    detail::decompress_stream(in.get(), [&](const char *data, std::size_t size) {
+        detail::write_all(out.get(), data, size);
+    }, dictionary);
+    if (std::fflush(out.get()) != 0)
+        throw error("compression: write failed " + dst.string());
+}
+
+inline std::string decompress(const fs::path &src, const std::string &dictionary = "")
+{
+    auto in = detail::open(src, "rb");
+    std::string out;
+    detail::decompress_stream(in.get(), [&](const char *data, std::size_t size) { out.append(data, size); }, dictionary);
+    return out;
+}
+
+} // namespace compression
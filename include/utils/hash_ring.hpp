@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "utils/case_layout.hpp"
+
+// Consistent hashing of keys onto a fixed list of named nodes. Every node owns virtual_nodes points
+// on a 64-bit ring and a key belongs to the node of the first point at or after its hash, so adding
+// or removing a node only moves the keys next to its own points, and the same key keeps landing on
+// the same node across restarts (placement depends on the names, not on their order).
+class HashRing
+{
+public:
+    HashRing(const std::vector<std::string> &nodes, std::size_t virtual_nodes) : node_count_(nodes.size())
+    {
+        points_.reserve(nodes.size() * virtual_nodes);
+        for (std::size_t n = 0; n < nodes.size(); ++n)
+            for (std::size_t v = 0; v < virtual_nodes; ++v)
+                points_.emplace_back(case_layout::hash(nodes[n] + "#" + std::to_string(v)), n);
+        std::sort(points_.begin(), points_.end());
+    }
+
+    // Indices of all nodes: the owner of key first, then the others in ring order, which is the
+    // order to spill over in when the owner is saturated.
+    std::vector<std::size_t> preference(std::string_view key) const
+    {
+        std::vector<std::size_t> order;
+        if (points_.empty())
+            return order;
+        std::vector<bool> seen(node_count_);
+        auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(case_layout::hash(key), std::size_t(0)));
+        for (std::size_t i = 0; i < points_.size() && order.size() < node_count_; ++i, ++it)
+        {
+            if (it == points_.end())
+                it = points_.begin();
+            if (!seen[it->second])
+            {
+                seen[it->second] = true;
+                order.push_back(it->second);
+            }
+        }
+        return order;
+    }
+
+    std::size_t size() const { return node_count_; }
+
+private:
+    std::size_t node_count_;
+    std::vector<std::pair<std::uint64_t, std::size_t>> points_; // hash, node index
+};
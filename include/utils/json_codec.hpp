@@ -0,0 +1,257 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Building blocks for schema-specific JSON codecs that avoid the nlohmann DOM on hot paths.
+// They only handle the common shape of our messages (flat objects, plain ASCII strings without
+// escapes); anything else is reported as unsupported so the caller can fall back to nlohmann,
+// which then also produces the usual error messages.
+namespace json_codec
+{
+
+// String with inline, fixed storage. Appends fail instead of allocating when it is full.
+template <std::size_t N>
+class FixedString
+{
+public:
+    bool append(std::string_view s)
+    {
+        if (s.size() > N - size_)
+            return false;
+        s.copy(data_ + size_, s.size());
+        size_ += s.size();
+        return true;
+    }
+
+    // Same result as std::filesystem::path::operator/= on POSIX.
+    bool append_path(std::string_view s)
+    {
+        if (!s.empty() && s.front() == '/')
+        {
+            clear();
+            return append(s);
+        }
+        if (size_ > 0 && data_[size_ - 1] != '/' && !append("/"))
+            return false;
+        return append(s);
+    }
+
+    void clear() { size_ = 0; }
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    char data_[N];
+    std::size_t size_ = 0;
+};
+
+enum class Token
+{
+    String,      // value is the raw string contents (no escapes present)
+    Literal,     // value is a number, true, false or null
+    End,         // closing brace reached and nothing but whitespace follows
+    Unsupported, // escapes, non-ASCII, nested values or malformed input
+};
+
+// Iterates the members of a flat JSON object in place; keys and values point into the body.
+class FlatObjectReader
+{
+public:
+    explicit FlatObjectReader(std::string_view body) : s_(body)
+    {
+        skip_ws();
+        ok_ = consume('{');
+        skip_ws();
+        if (ok_ && peek() == '}')
+        {
+            ++pos_;
+            closed_ = true;
+        }
+    }
+
+    Token next(std::string_view &key, std::string_view &value)
+    {
+        if (!ok_)
+            return Token::Unsupported;
+        if (closed_)
+        {
+            skip_ws();
+            return pos_ == s_.size() ? Token::End : fail();
+        }
+        if (!first_)
+        {
+            skip_ws();
+            if (!consume(','))
+                return fail();
+        }
+        first_ = false;
+
+        skip_ws();
+        if (!read_string(key))
+            return fail();
+        skip_ws();
+        if (!consume(':'))
+            return fail();
+        skip_ws();
+
+        Token token;
+        if (peek() == '"')
+        {
+            if (!read_string(value))
+                return fail();
+            token = Token::String;
+        }
+        else
+        {
+            std::size_t start = pos_;
+            while (pos_ < s_.size() && is_literal_char(s_[pos_]))
+                ++pos_;
+            value = s_.substr(start, pos_ - start);
+            if (!is_literal(value))
+                return fail();
+            token = Token::Literal;
+        }
+
+        skip_ws();
+        if (peek() == '}')
+        {
+            ++pos_;
+            closed_ = true;
+        }
+        return token;
+    }
+
+private:
+    std::string_view s_;
+    std::size_t pos_ = 0;
+    bool ok_ = true;
+    bool first_ = true;
+    bool closed_ = false;
+
+    char peek() const { return pos_ < s_.size() ? s_[pos_] : '\0'; }
+
+    bool consume(char c)
+    {
+        if (peek() != c)
+            return false;
+        ++pos_;
+        return true;
+    }
+
+    void skip_ws()
+    {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r'))
+            ++pos_;
+    }
+
+    static bool is_literal_char(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+    }
+
+    // Exactly what nlohmann accepts: true, false, null, or -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    static bool is_literal(std::string_view v)
+    {
+        if (v == "true" || v == "false" || v == "null")
+            return true;
+        std::size_t i = 0;
+        auto digits = [&] {
+            std::size_t start = i;
+            while (i < v.size() && v[i] >= '0' && v[i] <= '9')
+                ++i;
+            return i > start;
+        };
+        if (i < v.size() && v[i] == '-')
+            ++i;
+        if (i < v.size() && v[i] == '0')
+            ++i;
+        else if (!digits())
+            return false;
+        if (i < v.size() && v[i] == '.' && (++i, !digits()))
+            return false;
+        if (i < v.size() && (v[i] == 'e' || v[i] == 'E'))
+        {
+            ++i;
+            if (i < v.size() && (v[i] == '+' || v[i] == '-'))
+                ++i;
+            if (!digits())
+                return false;
+        }
+        return i == v.size();
+    }
+
+    bool read_string(std::string_view &out)
+    {
+        if (!consume('"'))
+            return false;
+        std::size_t start = pos_;
+        for (; pos_ < s_.size(); ++pos_)
+        {
+            auto c = static_cast<unsigned char>(s_[pos_]);
+            if (c == '"')
+            {
+                out = s_.substr(start, pos_ - start);
+                ++pos_;
+                return true;
+            }
+            if (c == '\\' || c < 0x20 || c >= 0x80)
+                return false;
+        }
+        return false;
+    }
+
+    Token fail()
+    {
+        ok_ = false;
+        return Token::Unsupported;
+    }
+};
+
+// Appends v in decimal, as nlohmann::json::dump() writes unsigned integers.
+inline void append_uint(std::string &out, std::uint64_t v)
+{
+    char buf[20];
+    auto end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+    out.append(buf, static_cast<std::size_t>(end - buf));
+}
+
+// Appends s as a quoted JSON string, escaped exactly like nlohmann::json::dump().
+// Returns false (leaving out partially written) if s contains non-ASCII bytes, whose
+// UTF-8 validation is left to nlohmann.
+inline bool append_string(std::string &out, std::string_view s)
+{
+    out.push_back('"');
+    for (char ch : s)
+    {
+        auto c = static_cast<unsigned char>(ch);
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c >= 0x80)
+                return false;
+            if (c < 0x20)
+            {
+                char buf[7];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out.append(buf, 6);
+            }
+            else
+                out.push_back(ch);
+        }
+    }
+    out.push_back('"');
+    return true;
+}
+
+} // namespace json_codec
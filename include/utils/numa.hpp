@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// NUMA nodes of this host as listed in sysfs, and a scope that places the processes started by the
+// calling thread on one of them. posix_spawn children inherit the thread's CPU affinity and memory
+// policy, so they run (and fault in the page cache they read) on that node from their first
+// instruction. Uses the raw syscalls; no libnuma.
+namespace numa
+{
+
+struct Node
+{
+    int id;
+    cpu_set_t cpus;
+    std::size_t cpu_count;
+};
+
+// Parses a sysfs cpulist such as "0-3,8-11".
+inline bool parse_cpulist(std::string_view list, cpu_set_t &cpus)
+{
+    CPU_ZERO(&cpus);
+    while (!list.empty() && std::isspace(static_cast<unsigned char>(list.back())))
+        list.remove_suffix(1);
+    while (!list.empty())
+    {
+        std::size_t comma = std::min(list.find(','), list.size());
+        std::string range(list.substr(0, comma));
+        list.remove_prefix(std::min(comma + 1, list.size()));
+        std::size_t dash = range.find('-');
+        try
+        {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+                CPU_SET(cpu, &cpus);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Nodes with at least one online CPU, by id; empty where sysfs has no NUMA information.
+inline std::vector<Node> nodes()
+{
+    std::vector<Node> out;
+    std::error_code ec;
+    for (auto &entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); }))
+            continue;
+        std::ifstream in(entry.path() / "cpulist");
+        std::string list;
+        std::getline(in, list);
+        Node node{std::stoi(name.substr(4)), {}, 0};
+        if (!parse_cpulist(list, node.cpus))
+            continue;
+        node.cpu_count = static_cast<std::size_t>(CPU_COUNT(&node.cpus));
+        if (node.cpu_count > 0)
+            out.push_back(node);
+    }
+    std::sort(out.begin(), out.end(), [](const Node &a, const Node &b) { return a.id < b.id; });
+    return out;
+}
+
+// Restricts the calling thread to the CPUs of node and makes it prefer the node's memory; the
+// destructor restores the previous affinity and the default memory policy.
+class ScopedPlacement
+{
+public:
+    explicit ScopedPlacement(const Node &node)
+    {
+        restore_ = ::sched_getaffinity(0, sizeof saved_, &saved_) == 0 &&
+                   ::sched_setaffinity(0, sizeof node.cpus, &node.cpus) == 0;
+        if (node.id >= 0 && node.id < 64)
+        {
+            unsigned long mask = 1UL << node.id;
+            ::syscall(SYS_set_mempolicy, mpol_preferred, &mask, sizeof(mask) * 8 + 1);
+        }
+    }
+
+    ~ScopedPlacement()
+    {
+        if (restore_)
+            ::sched_setaffinity(0, sizeof saved_, &saved_);
+        ::syscall(SYS_set_mempolicy, mpol_default, nullptr, 0);
+    }
+
+    ScopedPlacement(const ScopedPlacement &) = delete;
+    ScopedPlacement &operator=(const ScopedPlacement &) = delete;
+
+private:
+    static constexpr int mpol_default = 0;   // MPOL_DEFAULT
+    static constexpr int mpol_preferred = 1; // MPOL_PREFERRED
+    cpu_set_t saved_;
+    bool restore_;
+};
+
+} // namespace numa
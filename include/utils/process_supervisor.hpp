@@ -0,0 +1,209 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Child processes without SIGCHLD. A child is created with posix_spawn, which glibc implements
+// with CLONE_VM | CLONE_VFORK, so the cost does not grow with the parent's address space. It is
+// then tracked by a pidfd registered with the io_context and reaped with waitid(P_PIDFD), which
+// also yields its rusage. Only the child's own handler reaps it, so no other wait can steal its
+// status, and signals sent through the supervisor go to the pidfd and never to a recycled pid.
+//
+// Needs Linux 5.4 (pidfd_open, waitid P_PIDFD). Every running child holds one file descriptor.
+class ProcessSupervisor
+{
+public:
+    struct Exit
+    {
+        int code = -1;   // exit status; -1 when killed by a signal
+        int signal = 0;  // terminating signal, 0 when the child exited
+        struct rusage usage{};
+        std::uint64_t read_chars = 0;  // rchar / wchar of /proc/<pid>/io: bytes passed to read(2)
+        std::uint64_t write_chars = 0; // and write(2) and friends, page cache hits included
+    };
+
+    // ec is set when the child could not be waited for; exit then holds no status.
+    using ExitHandler = std::function<void(const Exit &exit, std::error_code ec)>;
+
+    explicit ProcessSupervisor(boost::asio::io_context &ioc) : ioc_(ioc) {}
+
+    ProcessSupervisor(const ProcessSupervisor &) = delete;
+    ProcessSupervisor &operator=(const ProcessSupervisor &) = delete;
+
+    // Starts argv[0] with arguments argv; on_exit runs on the io_context after the child has been
+    // reaped. The child's stdout and stderr go to output_fd, or are inherited for -1; env entries
+    // ("NAME=value") are added to this process's environment. Throws std::system_error if the
+    // process cannot be created. Thread-safe.
+    pid_t spawn(const std::vector<std::string> &argv, ExitHandler on_exit, int output_fd = -1,
+                const std::vector<std::string> &env = {})
+    {
+        std::vector<char *> args;
+        args.reserve(argv.size() + 1);
+        for (auto &arg : argv)
+            args.push_back(const_cast<char *>(arg.c_str()));
+        args.push_back(nullptr);
+
+        char **envp = environ;
+        std::vector<char *> extended;
+        if (!env.empty())
+        {
+            for (char **e = environ; *e; ++e)
+                extended.push_back(*e);
+            for (auto &entry : env)
+                extended.push_back(const_cast<char *>(entry.c_str()));
+            extended.push_back(nullptr);
+            envp = extended.data();
+        }
+
+        // The child starts with no blocked signals and default SIGPIPE, whatever this thread has.
+        posix_spawnattr_t attr;
+        ::posix_spawnattr_init(&attr);
+        sigset_t signals;
+        sigemptyset(&signals);
+        ::posix_spawnattr_setsigmask(&attr, &signals);
+        sigaddset(&signals, SIGPIPE);
+        ::posix_spawnattr_setsigdefault(&attr, &signals);
+        ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+        posix_spawn_file_actions_t actions;
+        ::posix_spawn_file_actions_init(&actions);
+        if (output_fd >= 0)
+        {
+            ::posix_spawn_file_actions_adddup2(&actions, output_fd, STDOUT_FILENO);
+            ::posix_spawn_file_actions_adddup2(&actions, output_fd, STDERR_FILENO);
+        }
+
+        pid_t pid;
+        int err = ::posix_spawn(&pid, args[0], &actions, &attr, args.data(), envp);
+        ::posix_spawn_file_actions_destroy(&actions);
+        ::posix_spawnattr_destroy(&attr);
+        if (err != 0)
+            throw std::system_error(err, std::generic_category(), "posix_spawn " + argv[0]);
+
+        int fd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+        if (fd < 0)
+        {
+            // It could never be observed: do not leave it running.
+            std::error_code ec(errno, std::generic_category());
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            throw std::system_error(ec, "pidfd_open");
+        }
+
+        auto child = std::make_shared<Child>(ioc_, pid, fd, std::move(on_exit));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            children_.emplace(pid, child);
+            ++spawned_;
+        }
+        wait(child);
+        return pid;
+    }
+
+    // Sends sig to a running child; false if pid is not (or no longer) one. Thread-safe.
+    bool signal(pid_t pid, int sig)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = children_.find(pid);
+        if (it == children_.end())
+            return false;
+        return ::syscall(SYS_pidfd_send_signal, it->second->descriptor.native_handle(), sig, nullptr, 0) == 0;
+    }
+
+    std::size_t running()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return children_.size();
+    }
+
+    std::size_t spawned()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return spawned_;
+    }
+
+private:
+    static constexpr idtype_t p_pidfd = static_cast<idtype_t>(3); // P_PIDFD, missing from older glibc
+
+    struct Child
+    {
+        Child(boost::asio::io_context &ioc, pid_t pid, int fd, ExitHandler on_exit)
+        : pid(pid), descriptor(ioc, fd), on_exit(std::move(on_exit)) {}
+
+        pid_t pid;
+        boost::asio::posix::stream_descriptor descriptor; // the pidfd, readable once the child exits
+        ExitHandler on_exit;
+    };
+
+    boost::asio::io_context &ioc_;
+    std::mutex mutex_;
+    std::unordered_map<pid_t, std::shared_ptr<Child>> children_;
+    std::size_t spawned_ = 0;
+
+    static void read_io_counters(pid_t pid, Exit &exit)
+    {
+        std::ifstream io("/proc/" + std::to_string(pid) + "/io");
+        std::string key;
+        std::uint64_t value;
+        while (io >> key >> value)
+        {
+            if (key == "rchar:")
+                exit.read_chars = value;
+            else if (key == "wchar:")
+                exit.write_chars = value;
+        }
+    }
+
+    void wait(const std::shared_ptr<Child> &child)
+    {
+        child->descriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+            [this, child](const boost::system::error_code &wait_ec)
+            {
+                Exit exit;
+                std::error_code ec = wait_ec;
+                if (!ec)
+                {
+                    // Still a zombie, so the pid cannot have been reused.
+                    read_io_counters(child->pid, exit);
+                    // The raw syscall, unlike the glibc wrapper, also returns the rusage.
+                    siginfo_t info{};
+                    long rc;
+                    do
+                        rc = ::syscall(SYS_waitid, p_pidfd, child->descriptor.native_handle(), &info, WEXITED, &exit.usage);
+                    while (rc != 0 && errno == EINTR);
+                    if (rc != 0)
+                        ec.assign(errno, std::generic_category());
+                    else if (info.si_code == CLD_EXITED)
+                        exit.code = info.si_status;
+                    else
+                        exit.signal = info.si_status;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    children_.erase(child->pid);
+                }
+                boost::system::error_code close_ec;
+                child->descriptor.close(close_ec);
+                child->on_exit(exit, ec);
+            });
+    }
+};
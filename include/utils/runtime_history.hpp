@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#include "utils/streaming_stats.hpp"
+
+// One finished simulator run, as kept in the runtime history.
+struct RunRecord
+{
+    std::string simulator;
+    std::string version;
+    std::uintmax_t input_bytes = 0;
+    double wall_seconds = 0;
+    double cpu_seconds = 0;  // user + system
+    long max_rss_kb = 0;
+    std::int64_t finished_at = 0; // unix time
+    std::uint64_t read_bytes = 0;
+    std::uint64_t write_bytes = 0;
+    std::uint64_t voluntary_ctxsw = 0;
+    std::uint64_t involuntary_ctxsw = 0;
+};
+
+inline void to_json(nlohmann::json &j, const RunRecord &r)
+{
+    j = nlohmann::json{
+        {"simulator"  , r.simulator},
+        {"version"    , r.version},
+        {"input_bytes", r.input_bytes},
+        {"wall_s"     , r.wall_seconds},
+        {"cpu_s"      , r.cpu_seconds},
+        {"max_rss_kb" , r.max_rss_kb},
+        {"finished_at", r.finished_at},
+        {"read_bytes" , r.read_bytes},
+        {"write_bytes", r.write_bytes},
+        {"vcsw"       , r.voluntary_ctxsw},
+        {"ivcsw"      , r.involuntary_ctxsw},
+    };
+}
+
+inline void from_json(const nlohmann::json &j, RunRecord &r)
+{
+    j.at("simulator").get_to(r.simulator);
+    j.at("version").get_to(r.version);
+    j.at("input_bytes").get_to(r.input_bytes);
+    j.at("wall_s").get_to(r.wall_seconds);
+    r.cpu_seconds = j.value("cpu_s", 0.0);
+    r.max_rss_kb = j.value("max_rss_kb", 0L);
+    r.finished_at = j.value("finished_at", std::int64_t(0));
+    r.read_bytes = j.value("read_bytes", std::uint64_t(0));
+    r.write_bytes = j.value("write_bytes", std::uint64_t(0));
+    r.voluntary_ctxsw = j.value("vcsw", std::uint64_t(0));
+    r.involuntary_ctxsw = j.value("ivcsw", std::uint64_t(0));
+}
+
+// Least-squares fit of runtime on input size with exponentially decaying weights, so the model
+// follows a simulator whose cost changes between versions of its inputs. Constant memory and O(1)
+// per sample. Falls back to the weighted mean while the input sizes seen are (nearly) all the same.
+class RuntimeModel
+{
+public:
+    explicit RuntimeModel(double decay = 0.99) : decay_(decay) {}
+
+    void add(double input_bytes, double seconds)
+    {
+        n_ = n_ * decay_ + 1;
+        sx_ = sx_ * decay_ + input_bytes;
+        sy_ = sy_ * decay_ + seconds;
+        sxx_ = sxx_ * decay_ + input_bytes * input_bytes;
+        sxy_ = sxy_ * decay_ + input_bytes * seconds;
+        ++samples_;
+    }
+
+    std::size_t samples() const { return samples_; }
+
+    std::optional<double> predict(double input_bytes) const
+    {
+        if (samples_ == 0)
+            return std::nullopt;
+        double mean_x = sx_ / n_, mean_y = sy_ / n_;
+        double var_x = sxx_ / n_ - mean_x * mean_x;
+        if (samples_ < 3 || var_x <= 1e-9 * (mean_x * mean_x + 1))
+            return mean_y;
+        double slope = (sxy_ / n_ - mean_x * mean_y) / var_x;
+        return std::max(0.0, mean_y + slope * (input_bytes - mean_x));
+    }
+
+private:
+    double decay_;
+    double n_ = 0, sx_ = 0, sy_ = 0, sxx_ = 0, sxy_ = 0; // decayed weight and sums
+    std::size_t samples_ = 0;
+};
+
+// Runtime history of the simulators on this host: a JSON-lines file of RunRecords and, per
+// simulator/version, a RuntimeModel trained from it plus summary statistics. The file is replayed
+// on load and, unless another process may still be appending to it, trimmed to its last max_records
+// lines then; record() appends one line with a single O_APPEND write. Thread-safe.
+class RuntimeHistory
+{
+public:
+    RuntimeHistory(std::filesystem::path file, std::size_t max_records) : file_(std::move(file)), max_records_(max_records) {}
+
+    ~RuntimeHistory()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    RuntimeHistory(const RuntimeHistory &) = delete;
+    RuntimeHistory &operator=(const RuntimeHistory &) = delete;
+
+    // Returns the number of records replayed; unreadable lines are skipped. Only the last max_records
+    // are replayed either way; trim also rewrites the file to them.
+    std::size_t load(bool trim = true)
+    {
+        std::vector<std::string> lines;
+        {
+            std::ifstream in(file_);
+            for (std::string line; std::getline(in, line);)
+                if (!line.empty())
+                    lines.push_back(std::move(line));
+        }
+        std::size_t first = lines.size() > max_records_ ? lines.size() - max_records_ : 0;
+        std::size_t replayed = 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = first; i < lines.size(); ++i)
+        {
+            auto j = nlohmann::json::parse(lines[i], nullptr, false);
+            if (j.is_discarded())
+                continue;
+            try
+            {
+                train(j.get<RunRecord>());
+                ++replayed;
+            }
+            catch (const std::exception &)
+            {
+            }
+        }
+        if (trim && first > 0)
+        {
+            auto tmp = file_;
+            tmp += ".tmp";
+            {
+                std::ofstream out(tmp, std::ios::trunc);
+                for (std::size_t i = first; i < lines.size(); ++i)
+                    out << lines[i] << '\n';
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmp, file_, ec);
+        }
+        fd_ = ::open(file_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        return replayed;
+    }
+
+    void record(const RunRecord &record)
+    {
+        std::string line = nlohmann::json(record).dump() + "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        train(record);
+        if (fd_ >= 0)
+            [[maybe_unused]] auto n = ::write(fd_, line.data(), line.size());
+    }
+
+    // Expected wall time in seconds of a run with an input of input_bytes; nullopt without history.
+    std::optional<double> predict(const std::string &simulator, const std::string &version, std::uintmax_t input_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = stats_.find(key(simulator, version));
+        if (it == stats_.end())
+            return std::nullopt;
+        return it->second.model.predict(static_cast<double>(input_bytes));
+    }
+
+    // Per simulator/version: runs, means of the per-run figures and the peak RSS, so a regression of
+    // a newly registered version shows next to its predecessor.
+    nlohmann::json summary()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nlohmann::json out = nlohmann::json::object();
+        for (auto &[name, s] : stats_)
+            out[name] = {
+                {"runs"                  , s.wall.count()},
+                {"mean_wall_s"           , s.wall.mean()},
+                {"mean_cpu_s"            , s.cpu.mean()},
+                {"max_rss_kb"            , s.max_rss_kb},
+                {"mean_read_bytes"       , s.read_bytes.mean()},
+                {"mean_write_bytes"      , s.write_bytes.mean()},
+                {"mean_voluntary_ctxsw"  , s.voluntary_ctxsw.mean()},
+                {"mean_involuntary_ctxsw", s.involuntary_ctxsw.mean()},
+            };
+        return out;
+    }
+
+private:
+    struct Stats
+    {
+        RuntimeModel model;
+        RunningStats wall;
+        RunningStats cpu;
+        RunningStats read_bytes;
+        RunningStats write_bytes;
+        RunningStats voluntary_ctxsw;
+        RunningStats involuntary_ctxsw;
+        long max_rss_kb = 0;
+    };
+
+    std::filesystem::path file_;
+    std::size_t max_records_;
+    int fd_ = -1;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Stats> stats_; // simulator/version
+
+    static std::string key(const std::string &simulator, const std::string &version)
+    {
+        return simulator + "/" + version;
+    }
+
+    // Called with mutex_ held.
+    void train(const RunRecord &record)
+    {
+        auto &s = stats_[key(record.simulator, record.version)];
+        s.model.add(static_cast<double>(record.input_bytes), record.wall_seconds);
+        s.wall.add(record.wall_seconds);
+        s.cpu.add(record.cpu_seconds);
+        s.read_bytes.add(static_cast<double>(record.read_bytes));
+        s.write_bytes.add(static_cast<double>(record.write_bytes));
+        s.voluntary_ctxsw.add(static_cast<double>(record.voluntary_ctxsw));
+        s.involuntary_ctxsw.add(static_cast<double>(record.involuntary_ctxsw));
+        s.max_rss_kb = std::max(s.max_rss_kb, record.max_rss_kb);
+    }
+};
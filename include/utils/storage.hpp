@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include "utils/common.hpp"
+
+// Where case files live. A backend owns a root directory that the simulators see as a plain path;
+// put/get/stat/list address files by a path relative to it (absolute paths below the root are
+// accepted as they are). attach() makes the root usable at startup and detach() undoes it.
+namespace storage
+{
+
+namespace fs = std::filesystem;
+
+struct FileStat
+{
+    std::uintmax_t size = 0;
+    fs::file_time_type modified;
+};
+
+// Contents of a case file: either owned bytes or a read-only mapping of the file.
+class Blob
+{
+public:
+    explicit Blob(std::string bytes) : bytes_(std::move(bytes)) {}
+    Blob(void *map, std::size_t size) : map_(map), size_(size) {}
+    Blob(Blob &&other) noexcept
+        : bytes_(std::move(other.bytes_)), map_(std::exchange(other.map_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    Blob(const Blob &) = delete;
+    Blob &operator=(const Blob &) = delete;
+    Blob &operator=(Blob &&other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            bytes_ = std::move(other.bytes_);
+            map_ = std::exchange(other.map_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    ~Blob() { unmap(); }
+
+    std::string_view view() const
+    {
+        return map_ ? std::string_view(static_cast<const char *>(map_), size_) : std::string_view(bytes_);
+    }
+
+    bool mapped() const { return map_ != nullptr; }
+
+private:
+    std::string bytes_;
+    void *map_ = nullptr;
+    std::size_t size_ = 0;
+
+    void unmap()
+    {
+        if (map_)
+            ::munmap(map_, size_);
+    }
+};
+
+class Backend
+{
+public:
+    explicit Backend(fs::path root) : root_(std::move(root)) {}
+    virtual ~Backend() = default;
+
+    Backend(const Backend &) = delete;
+    Backend &operator=(const Backend &) = delete;
+
+    virtual const char *name() const = 0;
+
+    // Throws std::runtime_error if the root cannot be made usable.
+    virtual void attach() = 0;
+    virtual void detach() noexcept {}
+    // Leaves the root attached at exit, for a successor that took over from this process.
+    virtual void keep_attached() noexcept {}
+
+    const fs::path &root() const { return root_; }
+    fs::path path(const fs::path &file) const { return root_ / file; }
+
+    // Writes data under a temporary name and renames it into place, so readers never see a partial
+    // file; parent directories are created. Throws std::runtime_error on failure.
+    virtual void put(const fs::path &file, std::string_view data)
+    {
+        fs::path dst = path(file);
+        std::error_code ec;
+        fs::create_directories(dst.parent_path(), ec);
+        fs::path tmp = dst;
+        tmp += ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Unable to write: " + tmp.string());
+        for (std::size_t done = 0; done < data.size();)
+        {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Unable to write: " + tmp.string());
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+        fs::rename(tmp, dst, ec);
+        if (ec)
+            throw std::runtime_error("Unable to publish: " + dst.string() + " -> " + ec.message());
+    }
+
+    // Contents of file, or nullopt if it cannot be read.
+    virtual std::optional<Blob> get(const fs::path &file)
+    {
+        int fd = ::open(path(file).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return std::nullopt;
+        std::string bytes;
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+            bytes.reserve(static_cast<std::size_t>(st.st_size));
+        char buffer[64 * 1024];
+        ssize_t n;
+        while ((n = ::read(fd, buffer, sizeof(buffer))) > 0)
+            bytes.append(buffer, static_cast<std::size_t>(n));
+        ::close(fd);
+        if (n < 0)
+            return std::nullopt;
+        return Blob(std::move(bytes));
+    }
+
+    std::optional<FileStat> stat(const fs::path &file) const
+    {
+        std::error_code ec;
+        fs::path p = path(file);
+        FileStat st;
+        st.size = fs::file_size(p, ec);
+        if (ec)
+            return std::nullopt;
+        st.modified = fs::last_write_time(p, ec);
+        if (ec)
+            return std::nullopt;
+        return st;
+    }
+
+    // Names of the entries of directory dir, unordered; empty if it cannot be read.
+    std::vector<std::string> list(const fs::path &dir) const
+    {
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (auto &entry : fs::directory_iterator(path(dir), ec))
+            names.push_back(entry.path().filename().string());
+        return names;
+    }
+
+protected:
+    fs::path root_;
+};
+
+// An NFS export mounted on the root; needs root privileges and a reachable server.
+class NfsBackend : public Backend
+{
+public:
+    NfsBackend(fs::path mount_point, std::string mount_command, std::string unmount_command)
+        : Backend(std::move(mount_point)), mount_command_(std::move(mount_command)), unmount_command_(std::move(unmount_command)) {}
+
+    ~NfsBackend() override { detach(); }
+
+    const char *name() const override { return "nfs"; }
+
+    // A mount left by the process this one took over from is adopted.
+    void attach() override
+    {
+        struct statfs st{};
+        constexpr long nfs_magic = 0x6969; // NFS_SUPER_MAGIC
+        if (::statfs(root_.c_str(), &st) == 0 && static_cast<long>(st.f_type) == nfs_magic)
+        {
+            SPDLOG_LOGGER_INFO(Logger::instance(), "NFS already mounted on {}", root_.string());
+            mounted_ = true;
+            return;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Mount NFS: {}", mount_command_);
+        if (safe_system(mount_command_) != 0)
+            throw std::runtime_error("Mount NFS Failed");
+        mounted_ = true;
+    }
+
+    void keep_attached() noexcept override
+    {
+        mounted_ = false;
+    }
+
+    void detach() noexcept override
+    {
+        if (!std::exchange(mounted_, false))
+            return;
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Unmount NFS: {}", unmount_command_);
+        safe_system(unmount_command_);
+    }
+
+private:
+    std::string mount_command_;
+    std::string unmount_command_;
+    bool mounted_ = false;
+};
+
+// A directory of the local file system, for a single host or a share mounted outside the platform.
+class LocalBackend : public Backend
+{
+public:
+    using Backend::Backend;
+
+    const char *name() const override { return "local"; }
+
+    void attach() override
+    {
+        std::error_code ec;
+        fs::create_directories(root_, ec);
+        if (ec || !fs::is_directory(root_, ec))
+            throw std::runtime_error("Unable to create storage directory: " + root_.string());
+    }
+};
+
+// A directory on tmpfs (/dev/shm) shared by the processes of one host: writing a case file is a copy
+// into the page cache and get() maps those pages instead of copying them out again.
+class ShmBackend : public LocalBackend
+{
+public:
+    using LocalBackend::LocalBackend;
+
+    const char *name() const override { return "shm"; }
+
+    void attach() override
+    {
+        LocalBackend::attach();
+        struct statfs st{};
+        constexpr long tmpfs_magic = 0x01021994; // TMPFS_MAGIC
+        if (::statfs(root_.c_str(), &st) == 0 && static_cast<long>(st.f_type) != tmpfs_magic)
+            SPDLOG_LOGGER_WARN(Logger::instance(), "Storage directory {} is not on tmpfs", root_.string());
+    }
+
+    std::optional<Blob> get(const fs::path &file) override
+    {
+        int fd = ::open(path(file).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return std::nullopt;
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return Blob(std::string());
+        }
+        void *map = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return Backend::get(file);
+        return Blob(map, static_cast<std::size_t>(st.st_size));
+    }
+};
+
+// Backend named by kind ("nfs", "local" or "shm"), or null for an unknown name.
+inline std::unique_ptr<Backend> make(const std::string &kind,
+                                     const fs::path &nfs_mount_point,
+                                     const std::string &mount_command,
+                                     const std::string &unmount_command,
+                                     const fs::path &local_dir,
+                                     const fs::path &shm_dir)
+{
+    if (kind == "nfs")
+        return std::make_unique<NfsBackend>(nfs_mount_point, mount_command, unmount_command);
+    if (kind == "local")
+        return std::make_unique<LocalBackend>(local_dir);
+    if (kind == "shm")
+        return std::make_unique<ShmBackend>(shm_dir);
+    return nullptr;
+}
+
+} // namespace storage
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+// Running count / min / max / mean, updated one sample at a time.
+class RunningStats
+{
+public:
+    void add(double x)
+    {
+        ++count_;
+        min_ = std::min(min_, x);
+        max_ = std::max(max_, x);
+        mean_ += (x - mean_) / static_cast<double>(count_);
+    }
+
+    std::size_t count() const { return count_; }
+    double min() const { return count_ ? min_ : std::numeric_limits<double>::quiet_NaN(); }
+    double max() const { return count_ ? max_ : std::numeric_limits<double>::quiet_NaN(); }
+    double mean() const { return count_ ? mean_ : std::numeric_limits<double>::quiet_NaN(); }
+
+private:
+    std::size_t count_ = 0;
+    double min_ = std::numeric_limits<double>::infinity();
+    double max_ = -std::numeric_limits<double>::infinity();
+    double mean_ = 0.0;
+};
+
+// Exponentially weighted moving average; the first sample is taken as is.
+class Ewma
+{
+public:
+    explicit Ewma(double alpha) : alpha_(alpha) {}
+
+    void add(double x)
+    {
+        value_ = count_++ ? value_ + alpha_ * (x - value_) : x;
+    }
+
+    std::size_t count() const { return count_; }
+    double value() const { return count_ ? value_ : std::numeric_limits<double>::quiet_NaN(); }
+
+private:
+    double alpha_;
+    std::size_t count_ = 0;
+    double value_ = 0.0;
+};
+
+// P-square streaming quantile estimator (Jain & Chlamtac, 1985).
+// Keeps five markers, so memory is constant no matter how many samples are added.
+class StreamingQuantile
+{
+public:
+    explicit StreamingQuantile(double p) : p_(p) {}
+
+    void add(double x)
+    {
+        if (count_ < 5)
+        {
+            q_[count_++] = x;
+            if (count_ == 5)
+            {
+                std::sort(q_.begin(), q_.end());
+                n_  = {1, 2, 3, 4, 5};
+                np_ = {1, 1 + 2 * p_, 1 + 4 * p_, 3 + 2 * p_, 5};
+                dn_ = {0, p_ / 2, p_, (1 + p_) / 2, 1};
+            }
+            return;
+        }
+        ++count_;
+
+        // Find the cell k such that q_[k] <= x < q_[k + 1], adjusting the extremes.
+        std::size_t k;
+        if (x < q_[0])
+        {
+            q_[0] = x;
+            k = 0;
+        }
+        else if (x >= q_[4])
+        {
+            q_[4] = x;
+            k = 3;
+        }
+        else
+        {
+            k = 0;
+            while (k < 3 && x >= q_[k + 1])
+                ++k;
+        }
+
+        for (std::size_t i = k + 1; i < 5; ++i)
+            n_[i] += 1;
+        for (std::size_t i = 0; i < 5; ++i)
+            np_[i] += dn_[i];
+
+        // Move the three middle markers towards their desired positions.
+        for (std::size_t i = 1; i < 4; ++i)
+        {
+            double d = np_[i] - n_[i];
+            if ((d >= 1 && n_[i + 1] - n_[i] > 1) || (d <= -1 && n_[i - 1] - n_[i] < -1))
+            {
+                int s = d >= 0 ? 1 : -1;
+                double qp = parabolic(i, s);
+                q_[i] = (q_[i - 1] < qp && qp < q_[i + 1]) ? qp : linear(i, s);
+                n_[i] += s;
+            }
+        }
+    }
+
+    double p() const { return p_; }
+    std::size_t count() const { return count_; }
+
+    double value() const
+    {
+        if (count_ == 0)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (count_ < 5)
+        {
+            // Not enough samples for the markers yet: use the exact order statistic.
+            std::array<double, 5> sorted = q_;
+            std::sort(sorted.begin(), sorted.begin() + count_);
+            auto idx = static_cast<std::size_t>(std::lround(p_ * static_cast<double>(count_ - 1)));
+            return sorted[idx];
+        }
+        return q_[2];
+    }
+
+private:
+    double p_;
+    std::size_t count_ = 0;
+    std::array<double, 5> q_{};  // marker heights
+    std::array<double, 5> n_{};  // actual marker positions
+    std::array<double, 5> np_{}; // desired marker positions
+    std::array<double, 5> dn_{}; // desired position increments
+
+    double parabolic(std::size_t i, int s) const
+    {
+        double d = s;
+        return q_[i] + d / (n_[i + 1] - n_[i - 1]) *
+                           ((n_[i] - n_[i - 1] + d) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i]) +
+                            (n_[i + 1] - n_[i] - d) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+    }
+
+    double linear(std::size_t i, int s) const
+    {
+        return q_[i] + s * (q_[i + s] - q_[i]) / (n_[i + s] - n_[i]);
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+// Per-case span recorder exporting the Chrome trace-event format (chrome://tracing, Perfetto).
+//
+// Events are written in the JSON array format, one complete ("ph":"X") event per line, with the
+// closing bracket omitted as the format allows. Files are opened with O_APPEND and every event is
+// a single write(), so components on the same host may share one file; traces from other hosts
+// can be concatenated after dropping their leading '['. Timestamps come from the system clock so
+// that spans of different processes line up.
+class Tracer
+{
+public:
+    ~Tracer()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool open(const std::string &path, const std::string &process_name)
+    {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            return false;
+        struct stat st{};
+        if (::fstat(fd_, &st) == 0 && st.st_size == 0)
+            write_line("[");
+        pid_ = static_cast<int>(::getpid());
+        nlohmann::json meta = {
+            {"name", "process_name"},
+            {"ph"  , "M"},
+            {"pid" , pid_},
+            {"args", {{"name", process_name}}},
+        };
+        write_line(meta.dump() + ",");
+        process_name_ = process_name;
+        return true;
+    }
+
+    bool enabled() const { return fd_ >= 0; }
+
+    static std::int64_t now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Random 64-bit id in hex, assigned once per case by the app.
+    static std::string new_trace_id()
+    {
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(rng()));
+        return buf;
+    }
+
+    void span(std::string_view name, std::string_view trace_id, std::int64_t start_us, std::int64_t end_us)
+    {
+        if (!enabled() || trace_id.empty())
+            return;
+        nlohmann::json event = {
+            {"name", name},
+            {"cat" , process_name_},
+            {"ph"  , "X"},
+            {"ts"  , start_us},
+            {"dur" , end_us > start_us ? end_us - start_us : 0},
+            {"pid" , pid_},
+            {"tid" , static_cast<long>(::syscall(SYS_gettid))},
+            {"args", {{"trace_id", trace_id}}},
+        };
+        write_line(event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + ",");
+    }
+
+private:
+    int fd_ = -1;
+    int pid_ = 0;
+    std::string process_name_;
+
+    void write_line(std::string line)
+    {
+        line += '\n';
+        [[maybe_unused]] auto n = ::write(fd_, line.data(), line.size());
+    }
+};
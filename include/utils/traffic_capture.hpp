@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include "utils/wire.hpp"
+
+// Traffic capture: every inbound request is appended to a JSONL trace together with its arrival
+// time, so that the trace can be re-issued later with the replay tool.
+//
+// One record per line:
+//   {"ts_us": <arrival, us since epoch>, "component": ..., "method": ..., "target": ...,
+//    "content_type": ..., "body": <text>}            JSON bodies
+//   {..., "body_b64": <base64>}                     binary (wire) bodies
+
+namespace base64
+{
+
+inline std::string encode(std::string_view in)
+{
+    static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    std::size_t i = 0;
+    for (; i + 2 < in.size(); i += 3)
+    {
+        std::uint32_t v = (std::uint8_t(in[i]) << 16) | (std::uint8_t(in[i + 1]) << 8) | std::uint8_t(in[i + 2]);
+        out += alphabet[(v >> 18) & 63];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += alphabet[v & 63];
+    }
+    if (i < in.size())
+    {
+        std::uint32_t v = std::uint8_t(in[i]) << 16;
+        if (i + 1 < in.size())
+            v |= std::uint8_t(in[i + 1]) << 8;
+        out += alphabet[(v >> 18) & 63];
+        out += alphabet[(v >> 12) & 63];
+        out += i + 1 < in.size() ? alphabet[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+inline std::string decode(std::string_view in)
+{
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+    std::string out;
+    std::uint32_t acc = 0;
+    int bits = 0;
+    for (char c : in)
+    {
+        int v = value(c);
+        if (v < 0)
+            continue; // padding or whitespace
+        acc = (acc << 6) | static_cast<std::uint32_t>(v);
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out += static_cast<char>((acc >> bits) & 0xff);
+        }
+    }
+    return out;
+}
+
+} // namespace base64
+
+class TrafficCapture
+{
+public:
+    // Start appending to path; returns false if the file cannot be opened.
+    bool open(const std::string &path, const std::string &component)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out_.open(path, std::ios::app);
+        component_ = component;
+        return static_cast<bool>(out_);
+    }
+
+    bool enabled() const { return out_.is_open(); }
+
+    // Accepts std::string_view-like arguments, including beast's string_view.
+    template <class Method, class Target, class ContentType, class Body>
+    void record(const Method &method, const Target &target, const ContentType &content_type, const Body &body)
+    {
+        if (enabled())
+            record_views(view(method), view(target), view(content_type), view(body));
+    }
+
+private:
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string component_;
+
+    template <class S>
+    static std::string_view view(const S &s)
+    {
+        return {s.data(), s.size()};
+    }
+
+    void record_views(std::string_view method, std::string_view target, std::string_view content_type, std::string_view body)
+    {
+        auto ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch()).count();
+
+        nlohmann::json j = {
+            {"ts_us"       , ts_us},
+            {"component"   , component_},
+            {"method"      , method},
+            {"target"      , target},
+            {"content_type", content_type},
+        };
+        if (wire::is_wire(content_type))
+            j["body_b64"] = base64::encode(body);
+        else
+            j["body"] = body;
+        std::string line = j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out_ << line << '\n';
+        out_.flush();
+    }
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Compact binary encoding for the messages exchanged between app, request_manager and sim server.
+// It is selected per message by Content-Type; JSON stays the default.
+//
+// Frame layout (integers little endian):
+//   magic "NDTW" | schema version (u8) | kind (u8) | payload length (u32) | payload
+// Payload fields are written in declaration order: strings as u32 length + bytes, bools as u8,
+// counters as u64.
+// Fields added by a later schema version are appended, so a reader ignores trailing payload bytes
+// it does not know about and treats missing trailing fields as absent.
+//
+// Schema versions:
+//   1  initial layout
+//   2  optional trailing trace_id on Request and Result
+//   3  optional trailing codec (utils/compression.hpp) on Request and Result
+//   4  optional trailing affinity on Request
+//   5  optional trailing resource usage on Result (presence flag, then eight u64 counters)
+
+inline const std::string json_content_type = "application/json";
+inline const std::string wire_content_type = "application/x-ndt-wire";
+
+namespace wire
+{
+
+inline constexpr char magic[4] = {'N', 'D', 'T', 'W'};
+inline constexpr std::uint8_t schema_version = 5;
+inline constexpr std::size_t header_size = 10;
+
+enum class Kind : std::uint8_t
+{
+    Request = 1, // SimulationRequest / SimulationTask
+    Result  = 2, // SimulationResult
+};
+
+struct error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+// Whether a Content-Type header value selects the binary encoding. Templated so that both
+// std::string_view and beast's string_view (boost::string_view on older Boost) are accepted.
+template <class StringLike>
+inline bool is_wire(const StringLike &content_type)
+{
+    std::string_view v(content_type.data(), content_type.size());
+    return v.substr(0, wire_content_type.size()) == wire_content_type;
+}
+
+class Writer
+{
+public:
+    Writer(std::string &out, Kind kind) : out_(out), start_(out.size())
+    {
+        out_.append(magic, sizeof(magic));
+        out_.push_back(static_cast<char>(schema_version));
+        out_.push_back(static_cast<char>(kind));
+        put_u32(0); // patched by finish()
+    }
+
+    void put_string(std::string_view s)
+    {
+        put_u32(static_cast<std::uint32_t>(s.size()));
+        out_.append(s.data(), s.size());
+    }
+
+    void put_bool(bool b)
+    {
+        out_.push_back(b ? 1 : 0);
+    }
+
+    void put_u64(std::uint64_t v)
+    {
+        char b[8];
+        for (int i = 0; i < 8; ++i)
+            b[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+        out_.append(b, 8);
+    }
+
+    void finish()
+    {
+        auto len = static_cast<std::uint32_t>(out_.size() - start_ - header_size);
+        for (int i = 0; i < 4; ++i)
+            out_[start_ + 6 + i] = static_cast<char>((len >> (8 * i)) & 0xff);
+    }
+
+private:
+    std::string &out_;
+    std::size_t start_;
+
+    void put_u32(std::uint32_t v)
+    {
+        char b[4];
+        for (int i = 0; i < 4; ++i)
+            b[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+        out_.append(b, 4);
+    }
+};
+
+// Reads a frame in place; the string_views it returns point into the input buffer.
+class Reader
+{
+public:
+    Reader(std::string_view in, Kind kind)
+    {
+        if (in.size() < header_size || std::memcmp(in.data(), magic, sizeof(magic)) != 0)
+            throw error("wire: bad frame header");
+        // Newer versions only append fields, so they are readable as well.
+        version_ = static_cast<std::uint8_t>(in[4]);
+        if (version_ == 0)
+            throw error("wire: unsupported schema version 0");
+        if (static_cast<Kind>(in[5]) != kind)
+            throw error("wire: unexpected message kind");
+        pos_ = 6;
+        data_ = in;
+        std::uint32_t len = get_u32();
+        if (len > in.size() - header_size)
+            throw error("wire: truncated payload");
+        data_ = in.substr(header_size, len);
+        pos_ = 0;
+    }
+
+    std::uint8_t version() const { return version_; }
+    bool at_end() const { return pos_ >= data_.size(); }
+
+    std::string_view get_string()
+    {
+        std::uint32_t len = get_u32();
+        need(len);
+        auto s = data_.substr(pos_, len);
+        pos_ += len;
+        return s;
+    }
+
+    bool get_bool()
+    {
+        need(1);
+        return data_[pos_++] != 0;
+    }
+
+    std::uint64_t get_u64()
+    {
+        need(8);
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v |= static_cast<std::uint64_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+        pos_ += 8;
+        return v;
+    }
+
+private:
+    std::string_view data_;
+    std::size_t pos_ = 0;
+    std::uint8_t version_ = 0;
+
+    void need(std::size_t n)
+    {
+        if (data_.size() - pos_ < n)
+            throw error("wire: truncated field");
+    }
+
+    std::uint32_t get_u32()
+    {
+        need(4);
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i)
+            v |= static_cast<std::uint32_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+        pos_ += 4;
+        return v;
+    }
+};
+
+} // namespace wire
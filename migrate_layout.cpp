@@ -0,0 +1,108 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "settings/case_layout.hpp"
+#include "utils/Logger.hpp"
+
+namespace fs = std::filesystem;
+
+// Moves case directories of existing sweeps from the flat legacy layout into the configured sharded
+// layout (settings/case_layout.hpp). Each case is moved with a single rename, so a case is always
+// complete at either location, and readers with case_layout_legacy_fallback find it during the run.
+// Sweeps with queued or running cases should not be migrated.
+
+static void usage(const char *prog)
+{
+    std::cout << "Usage: " << prog << " [--dry-run] <sweep dir>...\n"
+                 "  A sweep dir holds the case directories of one simulator version, e.g.\n"
+                 "  /srv/nfs/sim/<app_id>/<simulator>/<version> on the NFS server.\n"
+                 "  --dry-run             only report what would be moved\n"
+                 "  --logfile, -f         also write logs to netdt.log\n"
+                 "  --loglevel, -l lvl    set log level\n";
+}
+
+int main(int argc, char *argv[])
+{
+    bool dry_run = false;
+    std::vector<fs::path> sweeps;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--dry-run")
+            dry_run = true;
+        else if (arg == "--loglevel" || arg == "-l")
+            ++i;
+        else if (arg[0] != '-')
+            sweeps.emplace_back(arg);
+    }
+    if (sweeps.empty())
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (case_dir_layout.levels == 0)
+    {
+        std::cerr << "case_dir_layout is the legacy layout; nothing to migrate\n";
+        return EXIT_FAILURE;
+    }
+
+    auto cfg = Logger::parse_cli_args(argc, argv);
+    Logger::init(cfg);
+
+    std::size_t moved = 0, failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &sweep : sweeps)
+    {
+        // Collect first: renaming while iterating the same directory is unspecified.
+        std::vector<std::string> cases;
+        std::error_code ec;
+        for (auto &entry : fs::directory_iterator(sweep, ec))
+        {
+            std::string name = entry.path().filename().string();
+            if (entry.is_directory() && !case_layout::is_shard_name(name, case_dir_layout))
+                cases.push_back(name);
+        }
+        if (ec)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to list {}: {}", sweep.string(), ec.message());
+            ++failed;
+            continue;
+        }
+
+        for (auto &case_id : cases)
+        {
+            fs::path from = case_layout::legacy_case_dir(sweep, case_id);
+            fs::path to = case_layout::case_dir(sweep, case_id, case_dir_layout);
+            if (dry_run)
+            {
+                SPDLOG_LOGGER_INFO(Logger::instance(), "{} -> {}", from.string(), to.string());
+                ++moved;
+                continue;
+            }
+            fs::create_directories(to.parent_path(), ec);
+            if (!ec)
+                fs::rename(from, to, ec);
+            if (ec)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Move {} failed: {}", from.string(), ec.message());
+                ++failed;
+                continue;
+            }
+            ++moved;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "{}: {} cases", sweep.string(), cases.size());
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    SPDLOG_LOGGER_INFO(Logger::instance(), "{} {} cases ({} failed) in {:.1f}s",
+                       dry_run ? "Would move" : "Moved", moved, failed, seconds);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
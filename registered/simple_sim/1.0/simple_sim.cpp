@@ -1,66 +1,78 @@
-#include <iostream>
-#include <fstream>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
 #include <string>
+#include <string_view>
 #include <thread>
-#include <chrono>
-#include "utils/Logger.hpp"
+#include "sdk/simulator.hpp"
 
-int main(int argc, char *argv[])
+// Parses the next whitespace-separated integer of s, advancing s past it.
+static bool next_int(std::string_view &s, int &value)
 {
-    // Number of parameters to check
-    if (argc < 3)
-    {
-        std::cerr << "Usage: " << argv[0] << " <inputfilepath> <outputfilepath>\n";
-        return 1;
-    }
-
-    auto cfg = Logger::parse_cli_args(argc, argv);
-    Logger::init(cfg);
-    // SPDLOG_LOGGER_INFO(Logger::instance(), "Logger Loads Successfully!");
-
-    std::string inputFilePath = argv[1];
-    std::string outputFilePath = argv[2];
-
-    // Open input file
-    std::ifstream inputFile(inputFilePath);
-    if (!inputFile.is_open())
-    {
-        SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to open input file: {}", inputFilePath);
-        return EXIT_FAILURE;
-    }
+    auto start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos)
+        return false;
+    auto [end, ec] = std::from_chars(s.data() + start, s.data() + s.size(), value);
+    if (ec != std::errc())
+        return false;
+    s.remove_prefix(static_cast<std::size_t>(end - s.data()));
+    return true;
+}
 
-    // Read two numbers
-    int a, b;
-    if (!(inputFile >> a >> b))
+int main(int argc, char *argv[])
+{
+    return sim_sdk::run(argc, argv, [](sim_sdk::Case &c)
     {
-        SPDLOG_LOGGER_ERROR(Logger::instance(),
-            "The entered file content is incorrect; it must contain two numbers. File path: '{}'", inputFilePath);
-
-        inputFile.clear();                 // clear failbit
-        inputFile.seekg(0);                // rewind
-        std::string preview((std::istreambuf_iterator<char>(inputFile)), {});
-        if (preview.size() > 200) { preview.resize(200); preview += "…"; }
-        SPDLOG_LOGGER_ERROR(Logger::instance(), "File content preview:\n{}", preview);
+        // Read two numbers and an optional step count
+        std::string_view input = c.input().data();
+        std::string_view rest = input;
+        int a, b;
+        if (!next_int(rest, a) || !next_int(rest, b))
+        {
+            SPDLOG_LOGGER_ERROR(sim_sdk::logger(),
+                "The entered file content is incorrect; it must contain two numbers. File path: '{}'", c.input_path());
 
-        return EXIT_FAILURE;
-    }
+            std::string preview(input.substr(0, 200));
+            if (input.size() > 200) preview += "…";
+            SPDLOG_LOGGER_ERROR(sim_sdk::logger(), "File content preview:\n{}", preview);
 
+            return EXIT_FAILURE;
+        }
+        int steps = 1;
+        if (!next_int(rest, steps) || steps < 1)
+            steps = 1;
 
-    // std::this_thread::sleep_for(std::chrono::seconds(2));
-
-    int sum = a + b;
-
-    // Write to output file
-    std::ofstream outputFile(outputFilePath);
-    if (!outputFile.is_open())
-    {
-        SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to open output file: {}", outputFilePath);
-        return EXIT_FAILURE;
-    }
+        // Adds b once per step, 100ms each, resuming from "<step> <sum>" when a checkpoint exists.
+        int step = 0;
+        int sum = a;
+        if (auto state = c.load_checkpoint())
+        {
+            std::string_view saved = *state;
+            if (!next_int(saved, step) || !next_int(saved, sum))
+            {
+                step = 0;
+                sum = a;
+            }
+            SPDLOG_LOGGER_INFO(sim_sdk::logger(), "Resuming at step {} of {}", step, steps);
+        }
+        for (; step < steps; ++step)
+        {
+            if (c.checkpoint_requested())
+            {
+                c.save_checkpoint(std::to_string(step) + " " + std::to_string(sum));
+                SPDLOG_LOGGER_INFO(sim_sdk::logger(), "Checkpointed at step {} of {}", step, steps);
+                return sim_sdk::checkpoint_exit_code;
+            }
+            if (steps > 1)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            sum += b;
+        }
 
-    outputFile << sum << "\n";
-    outputFile.close();
+        // Write to output file
+        c.output().print("{}\n", sum);
+        c.output().commit();
 
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Successfully wrote {} + {} = {} into {}", a, b, sum, outputFilePath);
-    return EXIT_SUCCESS;
+        SPDLOG_LOGGER_DEBUG(sim_sdk::logger(), "Successfully wrote {} + {} * {} = {} into {}", a, b, steps, sum, c.output_path());
+        return EXIT_SUCCESS;
+    });
 }
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "utils/Logger.hpp"
+#include "utils/common.hpp"
+#include "utils/traffic_capture.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using json = nlohmann::json;
+using clock_type = std::chrono::steady_clock;
+
+// Re-issues a trace captured with --capture (see utils/traffic_capture.hpp) against a local
+// deployment and reports latency and throughput, optionally compared to a previous report.
+
+struct TraceRecord
+{
+    std::int64_t ts_us;
+    std::string method;
+    std::string target;
+    std::string content_type;
+    std::string body;
+};
+
+struct Sample
+{
+    bool ok = false;
+    unsigned status = 0;
+    double latency_ms = 0;
+    double lag_ms = 0; // how late the request was sent compared to its schedule
+};
+
+static void usage(const char *prog)
+{
+    std::cout << "Usage: " << prog << " <trace.jsonl> --port <port> [options]\n"
+                 "  --host <host>         target host (default 127.0.0.1)\n"
+                 "  --port <port>         target port\n"
+                 "  --component <name>    only replay records captured by this component\n"
+                 "  --speed <s>           original (default), max, or a factor such as 2 or 0.5\n"
+                 "  --connections <n>     concurrent keep-alive connections (default 4)\n"
+                 "  --report <file>       write the report as JSON\n"
+                 "  --baseline <file>     print deltas against a previous report\n"
+                 "  --logfile, -f         also write logs to netdt.log\n"
+                 "  --loglevel, -l lvl    set log level\n";
+}
+
+// Parses all of arg as an int or a double; false for anything std::stoi/std::stod would reject or
+// only partly consume.
+template <class T>
+static bool parse_number(const std::string &arg, T &value)
+{
+    try
+    {
+        std::size_t used = 0;
+        if constexpr (std::is_same_v<T, int>)
+            value = std::stoi(arg, &used);
+        else
+            value = std::stod(arg, &used);
+        return used == arg.size();
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+static std::vector<TraceRecord> load_trace(const std::string &path, const std::string &component)
+{
+    std::vector<TraceRecord> records;
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Unable to open trace: " + path);
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+        json j = json::parse(line);
+        if (!component.empty() && j.value("component", "") != component)
+            continue;
+        TraceRecord r;
+        r.ts_us = j.at("ts_us").get<std::int64_t>();
+        r.method = j.at("method").get<std::string>();
+        r.target = j.at("target").get<std::string>();
+        r.content_type = j.value("content_type", json_content_type);
+        r.body = j.contains("body_b64") ? base64::decode(j.at("body_b64").get<std::string>())
+                                        : j.value("body", "");
+        records.push_back(std::move(r));
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) { return a.ts_us < b.ts_us; });
+    return records;
+}
+
+// Each worker owns one keep-alive connection and takes the next due record from the shared index.
+static void replay_worker(const std::vector<TraceRecord> &records, std::vector<Sample> &samples,
+                          std::atomic<std::size_t> &next, clock_type::time_point start, double speed,
+                          const std::string &host, const std::string &port)
+{
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    bool connected = false;
+    const auto results = resolver.resolve(host, port);
+
+    for (std::size_t i = next++; i < records.size(); i = next++)
+    {
+        const TraceRecord &r = records[i];
+        Sample &sample = samples[i];
+
+        auto due = start;
+        if (speed > 0)
+            due += std::chrono::microseconds(static_cast<std::int64_t>((r.ts_us - records.front().ts_us) / speed));
+        std::this_thread::sleep_until(due);
+
+        auto sent = clock_type::now();
+        sample.lag_ms = std::chrono::duration<double, std::milli>(sent - due).count();
+
+        beast::error_code ec;
+        if (!connected)
+        {
+            stream.connect(results, ec);
+            if (ec)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to connect to {}:{}: {}", host, port, ec.message());
+                continue;
+            }
+            connected = true;
+        }
+
+        http::request<http::string_body> req{http::string_to_verb(r.method), r.target, 11};
+        req.set(http::field::host, host);
+        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+        req.set(http::field::content_type, r.content_type);
+        req.keep_alive(true);
+        req.body() = r.body;
+        req.prepare_payload();
+
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::write(stream, req, ec);
+        if (!ec)
+            http::read(stream, buffer, res, ec);
+        if (ec)
+        {
+            SPDLOG_LOGGER_WARN(Logger::instance(), "Request {} failed: {}", i, ec.message());
+            stream.socket().close(ec);
+            connected = false;
+            continue;
+        }
+
+        sample.ok = true;
+        sample.status = res.result_int();
+        sample.latency_ms = std::chrono::duration<double, std::milli>(clock_type::now() - sent).count();
+        if (!res.keep_alive())
+        {
+            stream.socket().close(ec);
+            connected = false;
+        }
+    }
+}
+
+static double percentile(std::vector<double> sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1))];
+}
+
+static json make_report(const std::vector<TraceRecord> &records, const std::vector<Sample> &samples, double duration_s)
+{
+    std::vector<double> latencies, lags;
+    std::map<std::string, std::size_t> status;
+    std::size_t errors = 0;
+    double sum = 0;
+    for (auto &s : samples)
+    {
+        lags.push_back(s.lag_ms);
+        if (!s.ok)
+        {
+            ++errors;
+            continue;
+        }
+        ++status[std::to_string(s.status)];
+        latencies.push_back(s.latency_ms);
+        sum += s.latency_ms;
+    }
+    double trace_s = records.empty() ? 0 : (records.back().ts_us - records.front().ts_us) / 1e6;
+
+    return json{
+        {"requests"        , samples.size()},
+        {"errors"          , errors},
+        {"status"          , status},
+        {"duration_s"      , duration_s},
+        {"throughput_rps"  , duration_s > 0 ? latencies.size() / duration_s : 0},
+        {"trace_duration_s", trace_s},
+        {"trace_rate_rps"  , trace_s > 0 ? records.size() / trace_s : 0},
+        {"latency_ms"      , {{"mean", latencies.empty() ? 0 : sum / latencies.size()},
+                              {"p50", percentile(latencies, 0.50)},
+                              {"p90", percentile(latencies, 0.90)},
+                              {"p99", percentile(latencies, 0.99)},
+                              {"max", percentile(latencies, 1.0)}}},
+        {"send_lag_ms"     , {{"p99", percentile(lags, 0.99)}, {"max", percentile(lags, 1.0)}}},
+    };
+}
+
+static void print_delta(const std::string &name, double base, double now)
+{
+    double pct = base != 0 ? (now - base) / base * 100.0 : 0;
+    SPDLOG_LOGGER_INFO(Logger::instance(), "  {:<16} {:>12.3f} -> {:>12.3f} ({:+.1f}%)", name, base, now, pct);
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+    }
+    if (argc < 2 || argv[1][0] == '-' || cli_option(argc, argv, "--port").empty())
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto cfg = Logger::parse_cli_args(argc, argv);
+    Logger::init(cfg);
+
+    const std::string trace_path = argv[1];
+    const std::string host = cli_option(argc, argv, "--host", "127.0.0.1");
+    const std::string port = cli_option(argc, argv, "--port");
+    const std::string speed_arg = cli_option(argc, argv, "--speed", "original");
+    const std::string report_path = cli_option(argc, argv, "--report");
+    const std::string baseline_path = cli_option(argc, argv, "--baseline");
+    const std::string connections_arg = cli_option(argc, argv, "--connections", "4");
+    int connections = 0;
+    if (!parse_number(connections_arg, connections))
+    {
+        std::cerr << "Invalid --connections: " << connections_arg << "\n";
+        usage(argv[0]);
+        return 2;
+    }
+    connections = std::max(1, connections);
+    // speed 0 means "as fast as possible"
+    double speed = speed_arg == "original" ? 1.0 : 0.0;
+    if (speed_arg != "original" && speed_arg != "max" && (!parse_number(speed_arg, speed) || speed <= 0))
+    {
+        std::cerr << "Invalid --speed: " << speed_arg << "\n";
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<TraceRecord> records;
+    try
+    {
+        records = load_trace(trace_path, cli_option(argc, argv, "--component"));
+    }
+    catch (const std::exception &e)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Load trace failed: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    if (records.empty())
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "No records to replay in {}", trace_path);
+        return EXIT_FAILURE;
+    }
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Replaying {} requests to {}:{} at speed {} over {} connections",
+                       records.size(), host, port, speed_arg, connections);
+
+    std::vector<Sample> samples(records.size());
+    std::atomic<std::size_t> next{0};
+    auto start = clock_type::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < connections; ++i)
+        workers.emplace_back([&] {
+            try
+            {
+                replay_worker(records, samples, next, start, speed, host, port);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Replay worker failed: {}", e.what());
+            }
+        });
+    for (auto &t : workers)
+        t.join();
+    double duration_s = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    json report = make_report(records, samples, duration_s);
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Report: {}", report.dump());
+    if (!report_path.empty())
+        std::ofstream(report_path) << report.dump(2) << '\n';
+
+    if (!baseline_path.empty())
+    {
+        std::ifstream in(baseline_path);
+        if (!in)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Unable to open baseline: {}", baseline_path);
+            return EXIT_FAILURE;
+        }
+        json base = json::parse(in);
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Compared with {}:", baseline_path);
+        print_delta("throughput_rps", base.at("throughput_rps").get<double>(), report.at("throughput_rps").get<double>());
+        for (const char *q : {"mean", "p50", "p90", "p99", "max"})
+            print_delta(std::string("latency_ms.") + q, base.at("latency_ms").at(q).get<double>(),
+                        report.at("latency_ms").at(q).get<double>());
+        print_delta("errors", base.at("errors").get<double>(), report.at("errors").get<double>());
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,13 +1,17 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <thread>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio/connect.hpp>
+#include <charconv>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/stacktrace.hpp>
 #include <boost/asio.hpp>
@@ -18,6 +22,13 @@
 
 #include "settings/request_manager.hpp"
 #include "utils/Logger.hpp"
+#include "utils/app_routes.hpp"
+#include "utils/case_index.hpp"
+#include "utils/common.hpp"
+#include "utils/hash_ring.hpp"
+#include "utils/json_codec.hpp"
+#include "utils/tracing.hpp"
+#include "utils/traffic_capture.hpp"
 #include "types/app.hpp"
 
 namespace beast = boost::beast;
@@ -26,8 +37,23 @@ namespace net = boost::asio;
 using tcp = net::ip::tcp;
 using json = nlohmann::json;
 
-static std::unordered_map<std::string, std::string> app_id2ip{{"power", "127.0.0.1"}};
-static std::unordered_map<std::string, std::string> app_id2port{{"power", "8000"}};
+static AppRoutingTable app_routes;
+static CaseIndex case_index;
+static TrafficCapture capture; // enabled with --capture <file>
+static Tracer tracer;           // enabled with --trace <file>
+
+// Placement of cases on sim_servers, by host:port.
+static const HashRing &sim_server_ring()
+{
+    static const HashRing ring = []
+    {
+        std::vector<std::string> names;
+        for (auto &server : sim_servers)
+            names.push_back(server.host + ":" + server.port);
+        return HashRing(names, sim_server_virtual_nodes);
+    }();
+    return ring;
+}
 
 class HttpSession : public std::enable_shared_from_this<HttpSession>
 {
@@ -60,6 +86,33 @@ private:
     beast::tcp_stream _out_stream;
     net::strand<net::io_context::executor_type> _strand;
     bool has_connect = false;
+    std::string _out_peer; // "host:port" _out_stream is connected to
+
+    // Results of different apps share _out_stream, so switching peers reconnects.
+    bool connect_upstream(const std::string &host, const std::string &port)
+    {
+        std::string peer = host + ":" + port;
+        if (has_connect && _out_peer == peer)
+            return true;
+        if (has_connect)
+        {
+            beast::error_code ignored;
+            _out_stream.socket().close(ignored);
+            has_connect = false;
+        }
+        boost::system::error_code ec;
+        const auto results = _resolver.resolve(host, port, ec);
+        if (!ec)
+            _out_stream.connect(results, ec);
+        if (ec)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to connect to {}: {}", peer, ec.message());
+            return false;
+        }
+        has_connect = true;
+        _out_peer = peer;
+        return true;
+    }
 
     void do_read()
     {
@@ -87,6 +140,8 @@ private:
                 return;
             }
 
+            capture.record(self->_req.method_string(), self->_req.target(),
+                           self->_req[http::field::content_type], self->_req.body());
             self->handle_request();
         });
     }
@@ -94,46 +149,47 @@ private:
     void handle_request()
     {
         SPDLOG_LOGGER_INFO(Logger::instance(), "Got request: {} {}", std::string(_req.method_string()), std::string(_req.target()));
-        SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", _req.body());
+        if (wire::is_wire(_req[http::field::content_type]))
+            SPDLOG_LOGGER_INFO(Logger::instance(), "body: {} bytes (wire)", _req.body().size());
+        else
+            SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", _req.body());
         SPDLOG_LOGGER_INFO(Logger::instance(), "keep alive: {}", _req.keep_alive());
 
-        if (_req.method() == http::verb::post && _req.target() == request_manager_target_for_app)
+        if (_req.method() == http::verb::post &&
+            (_req.target() == request_manager_target_for_app || _req.target() == request_manager_target_for_dag))
         {
+            // The app receives the sim server's answer, including 429/503 and Retry-After, so that
+            // admission control reaches the submitter instead of being swallowed here.
             try
             {
-                auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
-                res->set(http::field::content_type, "text/plain");
-                res->keep_alive(_req.keep_alive());
-                res->body() = "已收到 Request\n";
-                res->prepare_payload();
-
-                auto self = shared_from_this();
-                http::async_write(_in_stream, *res, [self, res](beast::error_code ec, std::size_t)
+                auto sub = std::make_shared<Submission>();
+                std::string key;
+                if (_req.target() == request_manager_target_for_dag)
                 {
-                    if (ec)
-                    {
-                        SPDLOG_LOGGER_ERROR(Logger::instance(), "async_write failed: {}", ec.message());
-                        return;
-                    }
-
-                    SPDLOG_LOGGER_INFO(Logger::instance(), "Wait for next request...");
-                    self->do_read(); // Go back to reading the next stroke
-                });
-
-                if (!has_connect)
+                    sub->cases = cases_of_dag(_req, key);
+                    sub->target = sim_server_dag_target;
+                }
+                else
                 {
-                    boost::system::error_code ec;
-                    const auto results = _resolver.resolve(sim_server_ip, sim_server_port);
-                    _out_stream.connect(results, ec);
-                    if (ec)
-                    {
-                        SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to connect to {}:{}: {}", sim_server_ip, sim_server_port, ec.message());
-                        return;
-                    }
-                    has_connect = true;
+                    sub->cases.push_back(case_of(_req));
+                    key = sub->cases.front().affinity.empty() ? sub->cases.front().case_id : sub->cases.front().affinity;
+                    sub->target = sim_server_target;
                 }
-
-                forwarding(sim_server_ip, sim_server_target, _req.body());
+                auto too_long = [](const SimulationRequest &c) { return c.case_id.size() > CaseIndex::max_case_id_size; };
+                if (std::any_of(sub->cases.begin(), sub->cases.end(), too_long))
+                {
+                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Reject submission: case_id longer than {} bytes", CaseIndex::max_case_id_size);
+                    reply_error(http::status::bad_request, "case_id too long");
+                    return;
+                }
+                sub->servers = sim_server_ring().preference(key);
+                sub->trace_id = trace_id_of(_req);
+                if (!sub->cases.empty())
+                    app_routes.find(sub->cases.front().app_id); // keeps the app's route alive
+                for (auto &sim_req : sub->cases)
+                    if (!sim_req.case_id.empty())
+                        case_index.update(sim_req.app_id, sim_req.case_id, sim_req.simulator, sim_req.version, CaseIndex::Status::Submitted);
+                dispatch(sub, 0);
             }
             catch (std::exception &e)
             {
@@ -141,53 +197,99 @@ private:
                 do_read(); // Go back to reading the next stroke
             }
         }
-        else if (_req.method() == http::verb::post && _req.target() == request_manager_target_for_sim_server)
+        else if (_req.method() == http::verb::post &&
+                 (_req.target() == request_manager_target_for_sim_server || _req.target() == request_manager_target_for_dag_result))
         {
+            auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
+            res->set(http::field::content_type, "text/plain");
+            res->keep_alive(_req.keep_alive());
+            res->body() = "Received Result\n";
+            res->prepare_payload();
+            reply(res); // reading resumes once it is written, so nothing below may call do_read()
+
             try
             {
-                auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
-                res->set(http::field::content_type, "text/plain");
-                res->keep_alive(_req.keep_alive());
-                res->body() = "Received Result\n";
-                res->prepare_payload();
-
-                auto self = shared_from_this();
-                http::async_write(_in_stream, *res, [self, res](beast::error_code ec, std::size_t)
+                std::string app_id, trace_id, what;
+                if (_req.target() == request_manager_target_for_dag_result)
                 {
-                    if (ec)
+                    DagResult dag_res = json::parse(_req.body()).get<DagResult>();
+                    for (auto &c : dag_res.cases)
                     {
-                        SPDLOG_LOGGER_ERROR(Logger::instance(), "async_write failed: {}", ec.message());
-                        return;
+                        CaseIndex::Status status = CaseIndex::Status::Failed;
+                        CaseIndex::parse_status(c.status, status);
+                        case_index.update(dag_res.app_id, c.case_id, c.simulator, c.version, status);
                     }
+                    app_id = dag_res.app_id;
+                    trace_id = dag_res.trace_id;
+                    what = "DAG " + dag_res.dag_id;
+                }
+                else
+                {
+                    SimulationResult sim_res;
+                    if (wire::is_wire(_req[http::field::content_type]))
+                        from_wire(_req.body(), sim_res);
+                    else
+                        sim_res = json::parse(_req.body()).get<SimulationResult>();
+                    case_index.update(sim_res.app_id, sim_res.case_id, sim_res.simulator, sim_res.version,
+                                      sim_res.success ? CaseIndex::Status::Completed : CaseIndex::Status::Failed);
+                    app_id = sim_res.app_id;
+                    trace_id = sim_res.trace_id;
+                    what = sim_res.case_id;
+                }
 
-                    SPDLOG_LOGGER_INFO(Logger::instance(), "Wait for next request...");
-                    self->do_read(); // Go back to reading the next stroke
-                });
-
-                json j = json::parse(_req.body());
-                SimulationResult sim_res = j.get<SimulationResult>();
-
-                if (!has_connect)
+                auto route = app_routes.find(app_id);
+                if (!route)
                 {
-                    boost::system::error_code ec;
-                    const auto results = _resolver.resolve(app_id2ip[sim_res.app_id], app_id2port[sim_res.app_id]);
-                    _out_stream.connect(results, ec);
-                    if (ec)
-                    {
-                        SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to connect to {}:{}: {}", app_id2ip[sim_res.app_id], app_id2port[sim_res.app_id], ec.message());
-                        return;
-                    }
-                    has_connect = true;
+                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Drop result of {}: app {} is not registered", what, app_id);
+                    return;
                 }
+                if (!connect_upstream(route->host, route->port))
+                    return;
 
-                forwarding(app_id2ip[sim_res.app_id], app_target, _req.body());
+                forwarding(route->host, route->target, content_type_of(_req), _req.body(), "forward_result", trace_id);
             }
             catch (std::exception &e)
             {
                 SPDLOG_LOGGER_ERROR(Logger::instance(), "handle request failed: {}", e.what());
-                do_read(); // Go back to reading the next stroke
             }
         }
+        else if (_req.method() == http::verb::post && _req.target() == request_manager_target_for_register)
+        {
+            AppRegistration reg;
+            std::string host, port, target;
+            try
+            {
+                reg = json::parse(_req.body()).get<AppRegistration>();
+            }
+            catch (std::exception &e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Invalid registration: {}", e.what());
+                reply_error(http::status::bad_request, "Invalid JSON request body");
+                return;
+            }
+            if (!parse_http_url(reg.simulation_completed_url, host, port, target))
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Invalid simulation_completed_url: {}", reg.simulation_completed_url);
+                reply_error(http::status::bad_request, "Invalid simulation_completed_url");
+                return;
+            }
+
+            std::string app_id = app_routes.add(reg.app_name, host, port, target);
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Registered app {} as {} -> {}:{}{}", reg.app_name, app_id, host, port, target);
+
+            // app_id is numeric; apps read it as an integer
+            auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
+            res->set(http::field::content_type, json_content_type);
+            res->keep_alive(_req.keep_alive());
+            res->body() = json{{"app_id", std::stol(app_id)}}.dump();
+            res->prepare_payload();
+            reply(res);
+        }
+        else if (_req.method() == http::verb::get &&
+                 target_path(std::string_view(_req.target().data(), _req.target().size())) == request_manager_target_for_cases)
+        {
+            handle_case_query();
+        }
         else
         {
             SPDLOG_LOGGER_ERROR(Logger::instance(),
@@ -196,14 +298,271 @@ private:
         }
     }
 
+    // A submission being dispatched: its cases and the sim servers to try, in ring order.
+    struct Submission
+    {
+        std::vector<SimulationRequest> cases;
+        std::vector<std::size_t> servers; // indices into sim_servers
+        std::string target;
+        std::string trace_id;
+    };
+
+    // Forwards the submission to sub->servers[attempt], moving on to the next server while one is
+    // saturated (429/503) or the submission could not be sent to it. Once a server received the
+    // submission it is never sent elsewhere, as the server may be running it: a lost answer is a 502
+    // and the case stays "submitted". The app gets the answer of the last server tried.
+    void dispatch(std::shared_ptr<Submission> sub, std::size_t attempt)
+    {
+        bool last = attempt + 1 >= sub->servers.size();
+        const SimServerAddress *server = attempt < sub->servers.size() ? &sim_servers[sub->servers[attempt]] : nullptr;
+        if (!server || !connect_upstream(server->host, server->port))
+        {
+            if (!last)
+            {
+                dispatch(sub, attempt + 1);
+                return;
+            }
+            index_admission(sub->cases, false);
+            reply_error(http::status::bad_gateway, "Simulation server unavailable");
+            return;
+        }
+
+        auto self = shared_from_this();
+        forwarding(server->host, sub->target, content_type_of(_req), _req.body(), "forward_task", sub->trace_id,
+        [self, sub, attempt, last, server](beast::error_code ec, bool sent, http::response<http::string_body> &upstream)
+        {
+            if (ec && sent)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "No answer from sim server {}:{} after sending the submission",
+                                    server->host, server->port);
+                self->reply_error(http::status::bad_gateway, "Simulation server did not answer");
+                return;
+            }
+            bool saturated = ec || upstream.result() == http::status::too_many_requests ||
+                             upstream.result() == http::status::service_unavailable;
+            if (saturated && !last)
+            {
+                SPDLOG_LOGGER_INFO(Logger::instance(), "Sim server {}:{} saturated, spilling over", server->host, server->port);
+                self->dispatch(sub, attempt + 1);
+                return;
+            }
+            index_admission(sub->cases, !ec && upstream.result() == http::status::ok);
+            if (ec)
+            {
+                self->reply_error(http::status::bad_gateway, "Simulation server unavailable");
+                return;
+            }
+            auto res = std::make_shared<http::response<http::string_body>>(upstream.result(), self->_req.version());
+            res->set(http::field::content_type, upstream[http::field::content_type]);
+            if (upstream.find(http::field::retry_after) != upstream.end())
+                res->set(http::field::retry_after, upstream[http::field::retry_after]);
+            res->keep_alive(self->_req.keep_alive());
+            res->body() = std::move(upstream.body());
+            res->prepare_payload();
+            self->reply(res);
+        });
+    }
+
+    // Bodies are forwarded verbatim, so keep the sender's encoding (JSON when unspecified).
+    static std::string content_type_of(const http::request<http::string_body> &req)
+    {
+        auto it = req.find(http::field::content_type);
+        return it == req.end() ? json_content_type : std::string(it->value());
+    }
+
+    // Submissions are forwarded without decoding, so only the ids of the case are picked out, in
+    // place for JSON. Fields that cannot be found are left empty.
+    static SimulationRequest case_of(const http::request<http::string_body> &req)
+    {
+        SimulationRequest sim_req;
+        try
+        {
+            if (wire::is_wire(req[http::field::content_type]))
+            {
+                from_wire(req.body(), sim_req);
+                return sim_req;
+            }
+            json_codec::FlatObjectReader reader(req.body());
+            std::string_view key, value;
+            auto token = reader.next(key, value);
+            for (; token == json_codec::Token::String || token == json_codec::Token::Literal; token = reader.next(key, value))
+            {
+                if (key == "app_id")
+                    sim_req.app_id = value;
+                else if (key == "case_id")
+                    sim_req.case_id = value;
+                else if (key == "simulator")
+                    sim_req.simulator = value;
+                else if (key == "version")
+                    sim_req.version = value;
+                else if (key == "affinity")
+                    sim_req.affinity = value;
+            }
+            if (token != json_codec::Token::End)
+            {
+                json j = json::parse(req.body());
+                sim_req.app_id = j.value("app_id", "");
+                sim_req.case_id = j.value("case_id", "");
+                sim_req.simulator = j.value("simulator", "");
+                sim_req.version = j.value("version", "");
+                sim_req.affinity = j.value("affinity", "");
+            }
+        }
+        catch (const std::exception &)
+        {
+        }
+        return sim_req;
+    }
+
+    // DAG bodies are small and JSON only, so they are parsed in full. Empty if the body is invalid.
+    // key is set to the placement key of the whole DAG: its affinity, else its dag_id.
+    static std::vector<SimulationRequest> cases_of_dag(const http::request<http::string_body> &req, std::string &key)
+    {
+        std::vector<SimulationRequest> cases;
+        try
+        {
+            json j = json::parse(req.body());
+            key = j.value("affinity", "");
+            if (key.empty())
+                key = j.value("dag_id", "");
+            std::string app_id = j.value("app_id", "");
+            for (auto &node : j.at("nodes"))
+            {
+                SimulationRequest &sim_req = cases.emplace_back();
+                sim_req.simulator = node.value("simulator", "");
+                sim_req.version = node.value("version", "");
+                sim_req.app_id = app_id;
+                sim_req.case_id = node.value("case_id", "");
+            }
+        }
+        catch (const std::exception &)
+        {
+            cases.clear();
+        }
+        return cases;
+    }
+
+    // A submission the sim server accepted is queued there (a DAG's nodes as a whole, though most
+    // wait for their parents); anything else is up to the app to retry.
+    static void index_admission(const std::vector<SimulationRequest> &cases, bool accepted)
+    {
+        for (auto &sim_req : cases)
+            if (!sim_req.case_id.empty())
+                case_index.update(sim_req.app_id, sim_req.case_id, sim_req.simulator, sim_req.version,
+                                  accepted ? CaseIndex::Status::Queued : CaseIndex::Status::Rejected);
+    }
+
+    // GET /cases?app_id=&status=&since=&cursor=&limit=
+    void handle_case_query()
+    {
+        std::string_view target(_req.target().data(), _req.target().size());
+        auto number = [&](const char *name, auto &out)
+        {
+            auto value = query_param(target, name);
+            if (!value)
+                return true;
+            auto [p, ec] = std::from_chars(value->data(), value->data() + value->size(), out);
+            return ec == std::errc() && p == value->data() + value->size();
+        };
+
+        CaseIndex::Query query;
+        query.limit = case_query_default_limit;
+        auto app_id = query_param(target, "app_id");
+        auto status = query_param(target, "status");
+        bool ok = app_id && !app_id->empty() && number("since", query.since) && number("cursor", query.cursor) &&
+                  number("limit", query.limit) && query.limit > 0;
+        if (ok && status)
+            ok = query.filter_status = CaseIndex::parse_status(*status, query.status);
+        if (!ok)
+        {
+            reply_error(http::status::bad_request, "Invalid case query");
+            return;
+        }
+        query.app_id = *app_id;
+        query.limit = std::min(query.limit, case_query_max_limit);
+
+        std::uint64_t next_cursor;
+        bool more;
+        json cases = json::array();
+        for (auto &c : case_index.query(query, next_cursor, more))
+        {
+            auto slash = c.simulator_version.find('/');
+            cases.push_back({
+                {"case_id"  , c.case_id},
+                {"simulator", c.simulator_version.substr(0, slash)},
+                {"version"  , c.simulator_version.substr(slash + 1)},
+                {"status"   , CaseIndex::status_name(c.status)},
+                {"updated"  , c.updated},
+            });
+        }
+
+        auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, _req.version());
+        res->set(http::field::content_type, json_content_type);
+        res->keep_alive(_req.keep_alive());
+        res->body() = json{{"cases", std::move(cases)}, {"next_cursor", next_cursor}, {"more", more}}.dump();
+        res->prepare_payload();
+        reply(res);
+    }
+
+    // Only decoded when tracing, since task bodies are otherwise forwarded without parsing.
+    static std::string trace_id_of(const http::request<http::string_body> &req)
+    {
+        if (!tracer.enabled())
+            return "";
+        try
+        {
+            if (!wire::is_wire(req[http::field::content_type]))
+                return json::parse(req.body()).value("trace_id", ""); // tasks and DAGs alike
+            SimulationRequest sim_req;
+            from_wire(req.body(), sim_req);
+            return sim_req.trace_id;
+        }
+        catch (const std::exception &)
+        {
+            return "";
+        }
+    }
+
+    void reply(std::shared_ptr<http::response<http::string_body>> res)
+    {
+        auto self = shared_from_this();
+        http::async_write(_in_stream, *res, [self, res](beast::error_code ec, std::size_t)
+        {
+            if (ec)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "async_write failed: {}", ec.message());
+                return;
+            }
+
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Wait for next request...");
+            self->do_read(); // Go back to reading the next stroke
+        });
+    }
+
+    void reply_error(http::status status, const std::string &message)
+    {
+        auto res = std::make_shared<http::response<http::string_body>>(status, _req.version());
+        res->set(http::field::content_type, json_content_type);
+        res->set(http::field::retry_after, std::to_string(upstream_retry_after_seconds));
+        res->keep_alive(_req.keep_alive());
+        res->body() = error_response_body(message);
+        res->prepare_payload();
+        reply(res);
+    }
+
+    // Called on the forwarding strand with the upstream response, or with the error that ended the
+    // exchange; sent tells whether the request had been written completely before it.
+    using ForwardHandler = std::function<void(beast::error_code, bool sent, http::response<http::string_body> &)>;
+
     // TODO: Instead, use a thread pool (1 or 2 threads are enough), and use blocking read/write operations within each thread.
-    void forwarding(const std::string &ip, const std::string &target, std::string &body)
+    void forwarding(const std::string &ip, const std::string &target, const std::string &content_type, std::string &body,
+                    const char *span_name, const std::string &trace_id, ForwardHandler on_response = nullptr)
     {
         auto req = std::make_shared<http::request<http::string_body>>(http::verb::post, target, _req.version());
         req->set(http::field::host, ip);
         req->keep_alive(_req.keep_alive());
         req->set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-        req->set(http::field::content_type, "application/json");
+        req->set(http::field::content_type, content_type);
         req->body() = body;
         req->prepare_payload();
 
@@ -214,35 +573,59 @@ private:
 
         // Post/dispatch to strand ensures no duplicate async operations.
         net::post(_strand,
-        [self, req, target_ptr, buffer, res]()
+        [self, req, target_ptr, buffer, res, span_name, trace_id, on_response]()
         {
             SPDLOG_LOGGER_INFO(Logger::instance(), "start forwarding {} to {}", std::string(req->method_string()), *target_ptr);
+            auto start_us = Tracer::now_us();
 
             beast::error_code ec;
+            http::response<http::string_body> res;
+
+            // Drop a broken upstream connection so that the next request reconnects.
+            bool sent = false;
+            auto fail = [&](const char *what)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "forwarding {} failed: {}", what, ec.message());
+                self->has_connect = false;
+                beast::error_code ignored;
+                self->_out_stream.socket().close(ignored);
+                if (on_response)
+                    on_response(ec, sent, res);
+            };
 
             http::write(self->_out_stream, *req, ec);
             if (ec)
             {
-                SPDLOG_LOGGER_ERROR(Logger::instance(), "forwarding write failed: {}", ec.message());
+                fail("write");
                 return;
             }
+            sent = true;
 
             SPDLOG_LOGGER_INFO(Logger::instance(), "forwarding {} to {}", std::string(req->method_string()), *target_ptr);
-            SPDLOG_LOGGER_INFO(Logger::instance(), "forwarding body = {}", req->body());
+            if (!wire::is_wire((*req)[http::field::content_type]))
+                SPDLOG_LOGGER_INFO(Logger::instance(), "forwarding body = {}", req->body());
 
             // Receive response
             beast::flat_buffer buffer;
-            http::response<http::string_body> res;
             http::read(self->_out_stream, buffer, res, ec);
 
             if (ec)
             {
-                SPDLOG_LOGGER_ERROR(Logger::instance(), "forwarding read failed: {}", ec.message());
+                fail("read");
                 return;
             }
 
+            tracer.span(span_name, trace_id, start_us, Tracer::now_us());
             SPDLOG_LOGGER_INFO(Logger::instance(), "forwarding Response: code = {}", res.result_int());
             SPDLOG_LOGGER_INFO(Logger::instance(), "forwarding body = {}", res.body());
+            if (!res.keep_alive())
+            {
+                self->has_connect = false;
+                beast::error_code ignored;
+                self->_out_stream.socket().close(ignored);
+            }
+            if (on_response)
+                on_response(ec, sent, res);
         });
     }
 };
@@ -253,6 +636,28 @@ int main(int argc, char *argv[])
     Logger::init(cfg);
     SPDLOG_LOGGER_INFO(Logger::instance(), "Logger Loads Successfully!");
 
+    std::string capture_path = cli_option(argc, argv, "--capture");
+    if (!capture_path.empty())
+    {
+        if (!capture.open(capture_path, "request_manager"))
+        {
+            SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to open capture file: {}", capture_path);
+            return EXIT_FAILURE;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Capturing inbound requests to {}", capture_path);
+    }
+
+    std::string trace_path = cli_option(argc, argv, "--trace");
+    if (!trace_path.empty())
+    {
+        if (!tracer.open(trace_path, "request_manager"))
+        {
+            SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to open trace file: {}", trace_path);
+            return EXIT_FAILURE;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Writing spans to {}", trace_path);
+    }
+
     net::io_context ioc;
     auto work = net::make_work_guard(ioc); // Prevent io_context from exiting prematurely
     tcp::acceptor acceptor{ioc, {tcp::v4(), request_manager_port}};
@@ -267,6 +672,25 @@ int main(int argc, char *argv[])
     };
 
     do_accept(do_accept); // Start retrieving accept
+
+    // Periodically drop apps that went quiet and free replaced routing snapshots
+    net::steady_timer sweep_timer(ioc);
+    std::function<void()> sweep_routes = [&]()
+    {
+        sweep_timer.expires_after(std::chrono::seconds(app_route_sweep_seconds));
+        sweep_timer.async_wait([&](beast::error_code ec)
+        {
+            if (ec)
+                return;
+            for (auto &app_id : app_routes.expire(app_route_ttl_seconds * 1000,
+                                                   [](const std::string &id) { return case_index.outstanding(id); }))
+                SPDLOG_LOGGER_WARN(Logger::instance(), "App {} expired after {}s without traffic", app_id, app_route_ttl_seconds);
+            if (std::size_t expired = case_index.expire(case_index_ttl_seconds))
+                SPDLOG_LOGGER_INFO(Logger::instance(), "Forgot {} cases not updated for {}s", expired, case_index_ttl_seconds);
+            sweep_routes();
+        });
+    };
+    sweep_routes();
     std::thread io_thread([&ioc]()
     {
         SPDLOG_LOGGER_INFO(Logger::instance(), "The server starts at http://localhost:" + std::to_string(request_manager_port));
@@ -0,0 +1,242 @@
+#include "sdk/simulator.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/Logger.hpp"
+
+namespace sim_sdk
+{
+
+namespace
+{
+
+LogConfig log_config;
+std::once_flag logger_once;
+std::string checkpoint_path;
+volatile std::sig_atomic_t checkpoint_signal = 0;
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void on_checkpoint_signal(int)
+{
+    checkpoint_signal = 1;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string &path) : path_(path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno("open " + path);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw_errno("stat " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ >= mmap_threshold)
+    {
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            throw_errno("mmap " + path);
+        }
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(p);
+        mapped_ = true;
+    }
+    else
+    {
+        small_.resize(size_);
+        std::size_t done = 0;
+        while (done < size_)
+        {
+            ssize_t n = ::read(fd, small_.data() + done, size_ - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+            {
+                ::close(fd);
+                throw_errno("read " + path);
+            }
+            if (n == 0)
+                break; // truncated meanwhile
+            done += static_cast<std::size_t>(n);
+        }
+        small_.resize(done);
+        data_ = small_.data();
+        size_ = done;
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapped_)
+        ::munmap(const_cast<char *>(data_), size_);
+}
+
+OutputFile::OutputFile(std::string path, bool durable)
+: path_(std::move(path)), tmp_path_(path_ + ".tmp"), durable_(durable)
+{
+    fd_ = ::open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw_errno("open " + tmp_path_);
+}
+
+OutputFile::~OutputFile()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+    if (!committed_)
+        ::unlink(tmp_path_.c_str());
+}
+
+void OutputFile::flush()
+{
+    std::size_t done = 0;
+    while (done < buffer_.size())
+    {
+        ssize_t n = ::write(fd_, buffer_.data() + done, buffer_.size() - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw_errno("write " + tmp_path_);
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    buffer_.clear();
+}
+
+void OutputFile::commit()
+{
+    if (committed_)
+        return;
+    flush();
+    if (durable_ && ::fsync(fd_) != 0)
+        throw_errno("fsync " + tmp_path_);
+    if (::close(fd_) != 0)
+    {
+        fd_ = -1;
+        throw_errno("close " + tmp_path_);
+    }
+    fd_ = -1;
+    if (::rename(tmp_path_.c_str(), path_.c_str()) != 0)
+        throw_errno("rename " + tmp_path_);
+    committed_ = true;
+}
+
+const MappedFile &Case::input()
+{
+    if (!input_)
+        input_.emplace(input_path_);
+    return *input_;
+}
+
+OutputFile &Case::output()
+{
+    if (!output_)
+        output_.emplace(output_path_);
+    return *output_;
+}
+
+bool Case::checkpoint_requested() const
+{
+    return checkpoint_signal != 0;
+}
+
+std::optional<std::string> Case::load_checkpoint()
+{
+    if (checkpoint_path.empty() || ::access(checkpoint_path.c_str(), F_OK) != 0)
+        return std::nullopt;
+    return std::string(MappedFile(checkpoint_path).data());
+}
+
+void Case::save_checkpoint(std::string_view state)
+{
+    if (checkpoint_path.empty())
+        throw std::system_error(std::make_error_code(std::errc::operation_not_supported), "checkpointing not enabled");
+    OutputFile file(checkpoint_path);
+    file.write(state);
+    file.commit();
+}
+
+std::shared_ptr<spdlog::logger> logger()
+{
+    std::call_once(logger_once, [] { Logger::init(log_config); });
+    return Logger::instance();
+}
+
+int run(int argc, char *argv[], const std::function<int(Case &)> &handler)
+{
+    // Positional arguments are input/output pairs; everything else belongs to the Logger.
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--loglevel" || arg == "-l")
+            ++i;
+        else if (arg.empty() || arg[0] != '-')
+            paths.push_back(std::move(arg));
+    }
+    if (paths.size() < 2 || paths.size() % 2 != 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " <inputfilepath> <outputfilepath> [<inputfilepath> <outputfilepath> ...]\n";
+        return EXIT_FAILURE;
+    }
+    log_config = Logger::parse_cli_args(argc, argv);
+    const bool batch = paths.size() > 2;
+    if (const char *file = std::getenv("NDT_CHECKPOINT_FILE"); file && !batch)
+    {
+        checkpoint_path = file;
+        struct sigaction action{};
+        action.sa_handler = on_checkpoint_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGUSR1, &action, nullptr);
+    }
+
+    int status = EXIT_SUCCESS;
+    for (std::size_t i = 0; i < paths.size(); i += 2)
+    {
+        Case c(i / 2, paths[i], paths[i + 1]);
+        int code;
+        try
+        {
+            code = handler(c);
+            if (code == checkpoint_exit_code && checkpoint_signal)
+                return checkpoint_exit_code;
+            if (code == 0 && c.output_ && !c.output_->committed())
+                c.output_->commit();
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_LOGGER_ERROR(logger(), "Case {} ({}) failed: {}", c.index(), c.input_path(), e.what());
+            code = EXIT_FAILURE;
+        }
+        if (code != 0)
+            status = EXIT_FAILURE;
+    }
+    return status;
+}
+
+} // namespace sim_sdk
@@ -5,122 +5,1661 @@
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/config.hpp>
-#include <boost/process.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <list>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <iostream>
+#include <optional>
 #include <queue>
 #include <nlohmann/json.hpp>
 
 #include "settings/sim_server.hpp"
 #include "types/sim_server.hpp"
 #include "utils/Logger.hpp"
+#include "utils/case_log.hpp"
 #include "utils/common.hpp"
+#include "utils/compression.hpp"
+#include "utils/fd_passing.hpp"
+#include "utils/hash_ring.hpp"
+#include "utils/numa.hpp"
+#include "utils/prefetch.hpp"
+#include "utils/process_supervisor.hpp"
+#include "utils/runtime_history.hpp"
+#include "utils/storage.hpp"
+#include "utils/streaming_stats.hpp"
+#include "utils/tracing.hpp"
+#include "utils/traffic_capture.hpp"
 
 namespace beast = boost::beast;
 namespace http  = beast::http;
 namespace net   = boost::asio;
-namespace bp    = boost::process;
 namespace fs    = std::filesystem;
 using     tcp   = net::ip::tcp;
 using     json  = nlohmann::json;
 
-void signal_handler(int signal) {
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Received signal {}, unmounting NFS", signal);
-    safe_system(unmount_nfs_command());
-    std::signal(signal, SIG_DFL);
-    std::raise(signal);
-}
+static compression::Options zstd_options; // level and dictionary for compressed case files
+static TrafficCapture capture; // enabled with --capture <file>
+static Tracer tracer;           // enabled with --trace <file>
+static std::unique_ptr<storage::Backend> case_storage; // selected with --storage <backend>
+// Accepted tasks and DAGs whose result has not yet left a session's callback queue; a draining
+// server exits once it drops to 0.
+static std::atomic<std::size_t> undelivered_results{0};
 
 void cleanup_on_exit() {
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Program exiting normally, unmounting NFS");
-    safe_system(unmount_nfs_command());
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Program exiting normally, detaching storage");
+    case_storage->detach();
 }
 
-void run_simulator(
-    net::io_context& ioc,
+// Returns the pid of the started simulator, whose stdout and stderr go to output_fd. on_complete
+// receives 0 on success, checkpoint_exit_code when the simulator saved a checkpoint to
+// checkpoint_file (empty: not offered one) and -1 otherwise, along with the exit status and resource
+// usage of the process (null if it could not be waited for). Throws if it cannot be started.
+pid_t run_simulator(
+    ProcessSupervisor& supervisor,
     net::strand<net::io_context::executor_type>& strand,
     const SimulationTask& task,
-    std::function<void(int)> on_complete)
+    int output_fd,
+    const std::string& checkpoint_file,
+    std::function<void(int, const ProcessSupervisor::Exit*)> on_complete)
+{
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Start Simulation: {}",
+                       simulator_exec_command(task.simulator, task.version, task.inputfile, task.outputfile));
+
+    auto spawn_start = Tracer::now_us();
+    pid_t pid = supervisor.spawn(simulator_exec_argv(task.simulator, task.version, task.inputfile, task.outputfile),
+        [strand, task, on_complete, spawn_start](const ProcessSupervisor::Exit& exit, std::error_code ec)
+        {
+            tracer.span("execute", task.trace_id, spawn_start, Tracer::now_us());
+            net::post(strand, [exit, ec, task, on_complete]
+            {
+                if (ec)
+                {
+                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Simulator {} failed to execute: {}", task.case_id, ec.message());
+                    on_complete(-1, nullptr);
+                    return;
+                }
+                if (exit.signal)
+                    SPDLOG_LOGGER_INFO(Logger::instance(), "{} Execution killed by signal {}", task.case_id, exit.signal);
+                else
+                    SPDLOG_LOGGER_INFO(Logger::instance(), "{} Execution completed, code = {}", task.case_id, exit.code);
+                on_complete(exit.code == 0 || exit.code == checkpoint_exit_code ? exit.code : -1, &exit);
+            });
+        }, output_fd, checkpoint_file.empty() ? std::vector<std::string>{} : std::vector<std::string>{"NDT_CHECKPOINT_FILE=" + checkpoint_file});
+    tracer.span("spawn", task.trace_id, spawn_start, Tracer::now_us());
+    return pid;
+}
+
+// MemAvailable from /proc/meminfo in MiB, or -1 when it cannot be read.
+long available_memory_mb()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    long value;
+    std::string unit;
+    while (meminfo >> key >> value >> unit)
+        if (key == "MemAvailable:")
+            return value / 1024;
+    return -1;
+}
+
+// The log file of a case that is no longer running, or an empty path if there is none. The request
+// only names the app and the case, so every simulator/version of the app is looked at.
+fs::path find_case_log(const std::string& app_id, const std::string& case_id)
+{
+    std::error_code ec;
+    for (auto& simulator : case_storage->list(app_id))
+        for (auto& version : case_storage->list(fs::path(app_id) / simulator))
+        {
+            fs::path sweep = case_storage->path(fs::path(app_id) / simulator / version);
+            fs::path dir = case_layout_legacy_fallback
+                ? case_layout::locate_case_dir(sweep, case_id, case_dir_layout)
+                : case_layout::case_dir(sweep, case_id, case_dir_layout);
+            fs::path log = dir / case_log_filename;
+            if (fs::exists(log, ec) || fs::exists(CaseLog::rotated(log), ec))
+                return log;
+        }
+    return {};
+}
+
+// Checks what from_json cannot: the node count, unique case ids, edges between nodes of the DAG, no
+// cycles, and handed-over files inside the case directory. Returns the reason to reject, or "".
+std::string validate_dag(const SimulationDag& dag)
+{
+    if (dag.nodes.empty() || dag.nodes.size() > max_dag_nodes)
+        return "A DAG needs 1 to " + std::to_string(max_dag_nodes) + " nodes";
+    std::unordered_map<std::string, std::size_t> index;
+    for (std::size_t i = 0; i < dag.nodes.size(); ++i)
+    {
+        auto& node = dag.nodes[i];
+        if (!index.emplace(node.case_id, i).second)
+            return "Duplicate case_id " + node.case_id;
+        if (!node.codec.empty())
+            return "Compressed case files are not supported in DAGs";
+        if (!check_simulator_exist(node.simulator, node.version))
+            return "Simulator NOT exist";
+    }
+
+    std::vector<std::size_t> parents(dag.nodes.size());
+    std::vector<std::vector<std::size_t>> children(dag.nodes.size());
+    for (auto& edge : dag.edges)
+    {
+        auto from = index.find(edge.from), to = index.find(edge.to);
+        if (from == index.end() || to == index.end())
+            return "Edge between unknown cases " + edge.from + " -> " + edge.to;
+        fs::path file(edge.inputfile);
+        if (file.is_absolute() || std::find(file.begin(), file.end(), fs::path("..")) != file.end())
+            return "Edge inputfile outside the case directory";
+        children[from->second].push_back(to->second);
+        ++parents[to->second];
+    }
+
+    // Kahn's algorithm reaches every node unless some are on a cycle.
+    std::vector<std::size_t> ready;
+    for (std::size_t i = 0; i < dag.nodes.size(); ++i)
+        if (parents[i] == 0)
+            ready.push_back(i);
+    std::size_t reached = 0;
+    while (!ready.empty())
+    {
+        std::size_t i = ready.back();
+        ready.pop_back();
+        ++reached;
+        for (std::size_t child : children[i])
+            if (--parents[child] == 0)
+                ready.push_back(child);
+    }
+    return reached == dag.nodes.size() ? "" : "DAG has a cycle";
+}
+
+// Admission control and the queue of accepted tasks. At most max_running_tasks simulators run at
+// once and up to max_queued_tasks wait, shortest expected job first (see sejf_enabled); submissions beyond that, or while memory is
+// low, are refused so that overload turns into client back-off instead of process storms.
+//
+// Stragglers are re-executed speculatively: the runtime distribution of every simulator/version is
+// tracked, and a task running longer than its speculation_percentile gets a duplicate on idle
+// capacity. The first successful attempt wins, the other one is killed, and only one result is
+// reported.
+//
+// The inputs of the tasks at the head of the queue are prefetched into the page cache, as far ahead
+// as the fetch latency and the launch rate call for; see prefetch_enabled.
+//
+// Tasks with an input-affinity key are pinned to a NUMA node chosen by consistent hashing of the
+// key, so the page cache they share stays local; see numa_placement_enabled.
+//
+// Long runs of checkpointable simulators are preempted when the queue head has waited too long: the
+// simulator checkpoints into its case directory and exits, and the case is queued again; see
+// preemption_enabled.
+//
+// A DAG of tasks is admitted as a whole. Its nodes wait outside the queue, though they count
+// against max_queued_tasks, until the outputs of all their parents have been handed over to them.
+class TaskScheduler
+{
+public:
+    enum class Admission { Accepted, QueueFull, LowMemory, Draining };
+
+    // A server taking over from a predecessor leaves the history file untrimmed: the predecessor
+    // still appends to it while it drains, and rewriting the file would lose those records.
+    TaskScheduler(net::io_context& ioc, bool taking_over)
+    : ioc_(ioc), supervisor_(ioc), strand_(net::make_strand(ioc)), speculation_timer_(strand_),
+      preemption_timer_(strand_), lease_timer_(strand_),
+      numa_nodes_(numa_placement_enabled ? numa::nodes() : std::vector<numa::Node>{}),
+      numa_ring_(numa_node_names(numa_nodes_), 64), numa_running_(numa_nodes_.size())
+    {
+        if (numa_nodes_.size() > 1)
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Placing tasks with an affinity key on {} NUMA nodes", numa_nodes_.size());
+        std::size_t runs = history_.load(!taking_over);
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Runtime history: {} runs from {}", runs, runtime_history_file.string());
+    }
+
+    // Pool jobs lock mutex_ and use the state declared after the pools, so the pools are joined
+    // before any member is destroyed.
+    ~TaskScheduler()
+    {
+        staging_pool_.join();
+        prefetch_pool_.join();
+    }
+
+    void run()
+    {
+        if (speculation_enabled)
+            net::post(strand_, [this] { schedule_speculation_check(); });
+        if (preemption_enabled)
+            net::post(strand_, [this] { schedule_preemption_check(); });
+        net::post(strand_, [this] { schedule_lease_refresh(); });
+    }
+
+    // 0 on success and -1 on failure, with the resources of the run that decided it, if one ran.
+    using CompletionHandler = std::function<void(int code, const std::optional<ResourceUsage>& usage)>;
+
+    // Thread-safe. An accepted task's eta is the expected number of seconds until it finishes, if its
+    // simulator has a runtime history.
+    Admission submit(const SimulationTask& task, std::int64_t received_us, CompletionHandler on_complete,
+                     std::optional<double>& eta)
+    {
+        if (draining_)
+            return Admission::Draining;
+        auto input_bytes = input_size(task);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.size() + dag_waiting_ >= max_queued_tasks)
+                return Admission::QueueFull;
+            if (memory_low())
+                return Admission::LowMemory;
+            std::string case_dir = case_dir_of(task.outputfile);
+            if (++active_cases_[case_dir] == 1)
+                net::post(staging_pool_, [case_dir] { touch_lease(case_dir); });
+            eta = enqueue({task, received_us, std::move(on_complete), std::move(case_dir), input_bytes});
+        }
+        net::post(strand_, [this] { launch_ready(); });
+        return Admission::Accepted;
+    }
+
+    // Thread-safe. dag must have passed validate_dag. on_complete receives the outcome of every node
+    // once all of them completed, failed or were skipped.
+    Admission submit_dag(const SimulationDag& dag, std::int64_t received_us, std::function<void(const DagResult&)> on_complete)
+    {
+        if (draining_)
+            return Admission::Draining;
+        auto run = make_dag_run(dag, received_us, std::move(on_complete));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.size() + dag_waiting_ + run->nodes.size() > max_queued_tasks)
+                return Admission::QueueFull;
+            if (memory_low())
+                return Admission::LowMemory;
+            for (auto& node : run->nodes)
+                if (++active_cases_[node.case_dir] == 1)
+                    net::post(staging_pool_, [case_dir = node.case_dir] { touch_lease(case_dir); });
+            dag_waiting_ += run->nodes.size();
+            ++dags_running_;
+        }
+        prepare_dag(run);
+        return Admission::Accepted;
+    }
+
+    // Thread-safe. Refuses further submissions; the tasks admitted so far still run.
+    void drain()
+    {
+        draining_ = true;
+    }
+
+    // Thread-safe. Runs fn unless a case in dir is queued or running; submissions wait meanwhile,
+    // so fn should be quick (the reaper only renames the directory).
+    bool unless_active(const fs::path& dir, const std::function<void()>& fn)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (active_cases_.count(dir.lexically_normal().string()))
+            return false;
+        fn();
+        return true;
+    }
+
+    // Captured output of a running case, null if it is not running here. Thread-safe.
+    std::shared_ptr<CaseLog> live_log(const std::string& app_id, const std::string& case_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = live_logs_.find(app_id + "/" + case_id);
+        return it == live_logs_.end() ? nullptr : it->second;
+    }
+
+    // Thread-safe snapshot for the metrics endpoint.
+    json metrics()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return json{
+            {"draining"   , draining_.load()},
+            {"queued"     , queue_.size()},
+            {"running"    , running_},
+            {"completed"  , completed_},
+            {"failed"     , failed_},
+            {"speculation", {
+                {"launched", speculations_},
+                {"wins"    , speculation_wins_},
+                {"rate"    , completed_ + failed_ ? double(speculations_) / double(completed_ + failed_) : 0.0},
+            }},
+            {"runtime_history", history_.summary()},
+            {"preemption", {
+                {"requested"   , preemptions_requested_},
+                {"checkpointed", preemptions_checkpointed_},
+            }},
+            {"prefetch", {
+                {"depth"     , prefetch_depth_},
+                {"issued"    , prefetch_issued_},
+                {"hits"      , prefetch_hits_},
+                {"late"      , prefetch_late_},
+                {"failed"    , prefetch_failed_},
+                {"bytes"     , prefetch_bytes_},
+                {"latency_ms", prefetch_latency_.count() ? prefetch_latency_.value() * 1000 : 0.0},
+            }},
+            {"numa", {
+                {"nodes"  , numa_nodes_.size()},
+                {"running", numa_running_},
+                {"placed" , numa_placed_},
+                {"spilled", numa_spilled_},
+            }},
+            {"dags", {
+                {"running"      , dags_running_},
+                {"waiting_nodes", dag_waiting_},
+                {"completed"    , dags_completed_},
+                {"failed"       , dags_failed_},
+            }},
+        };
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        SimulationTask task;
+        std::int64_t received_us;
+        CompletionHandler on_complete;
+        std::string case_dir; // NFS case directory, key of active_cases_
+        std::uintmax_t input_bytes = 0;
+        std::shared_ptr<std::atomic<bool>> prefetched{}; // set once a prefetch is issued, true when it finished
+        double estimate = 0;  // expected runtime in seconds, 0 without history
+        double order_key = 0; // queue position, ascending; see enqueue()
+    };
+
+    // A started task and its attempts: the primary run and at most one speculative duplicate.
+    struct RunningTask
+    {
+        SimulationTask task;
+        CompletionHandler on_complete;
+        std::optional<ResourceUsage> usage; // of the attempt that decided the outcome
+        clock::time_point started;
+        pid_t primary_pid = -1;
+        pid_t speculative_pid = -1;
+        int primary_node = -1;     // index into numa_nodes_ the attempt was placed on, -1 if none
+        int speculative_node = -1;
+        std::uintmax_t input_bytes = 0;
+        std::optional<SimulationTask> requeue_task; // as queued; set for checkpointable simulators
+        std::optional<clock::time_point> preempt_requested;
+        int outstanding = 0;    // attempts still running, or being staged
+        bool reported = false;  // outcome decided; at most one result is delivered
+        bool finishing = false; // output being compressed onto NFS
+        bool speculative_log_open = false; // the duplicate's log is still being written
+        bool speculative_won = false;
+        fs::path scratch;            // local working directory of a staged task
+        std::string nfs_outputfile;  // where a staged task's compressed output goes
+        std::string case_dir;
+    };
+
+    // A DAG after admission; only touched on strand_, apart from the immutable paths that the
+    // staging pool reads.
+    struct DagRun
+    {
+        enum class State { Waiting, Queued, HandingOff, Completed, Failed, Skipped };
+
+        struct Output
+        {
+            std::size_t child;
+            fs::path file; // where the child reads it
+        };
+
+        struct Node
+        {
+            SimulationTask task;        // outputfile is local when the output is handed over locally
+            std::string nfs_outputfile; // where the output is published
+            std::string nfs_inputfile;  // copied to task.inputfile when that is local, else empty
+            std::string case_dir;       // NFS case directory, key of active_cases_
+            std::vector<Output> outputs;
+            std::size_t waiting = 0;    // incoming edges not yet handed over
+            State state = State::Waiting;
+        };
+
+        std::string app_id;
+        std::string dag_id;
+        std::string trace_id;
+        std::int64_t received_us;
+        fs::path scratch; // local hand-off directory; empty without dag_local_handoff
+        std::vector<Node> nodes;
+        std::size_t unfinished; // nodes neither completed, failed nor skipped
+        std::function<void(const DagResult&)> on_complete;
+    };
+
+    net::io_context& ioc_;
+    ProcessSupervisor supervisor_;
+    net::strand<net::io_context::executor_type> strand_; // launches, completions and speculation
+    net::steady_timer speculation_timer_;
+    net::steady_timer preemption_timer_;
+    net::steady_timer lease_timer_;
+    net::thread_pool staging_pool_{staging_threads}; // (de)compression of staged case files
+    net::thread_pool prefetch_pool_{prefetch_threads}; // reads queued inputs into the page cache
+    RuntimeHistory history_{runtime_history_file, runtime_history_max_records};
+    std::mutex mutex_;
+    std::atomic<bool> draining_{false};
+    std::deque<Entry> queue_; // ascending order_key
+    std::size_t running_ = 0; // simulator processes, including speculative ones
+    std::size_t completed_ = 0, failed_ = 0, speculations_ = 0, speculation_wins_ = 0;
+    std::size_t preemptions_requested_ = 0, preemptions_checkpointed_ = 0;
+    std::chrono::steady_clock::time_point memory_checked_{};
+    bool memory_low_ = false;
+    std::vector<numa::Node> numa_nodes_; // empty unless placement is enabled
+    HashRing numa_ring_;
+    std::vector<std::size_t> numa_running_; // attempts per node
+    std::size_t numa_placed_ = 0, numa_spilled_ = 0;
+    std::size_t prefetch_depth_ = prefetch_min_depth; // queue entries to prefetch ahead
+    std::size_t prefetch_issued_ = 0, prefetch_hits_ = 0, prefetch_late_ = 0, prefetch_failed_ = 0;
+    std::uintmax_t prefetch_bytes_ = 0;
+    Ewma prefetch_latency_{0.2}; // seconds per prefetch
+    Ewma launch_interval_{0.2};  // seconds between launches while tasks are waiting
+    clock::time_point last_launch_{};
+    std::size_t dag_waiting_ = 0; // DAG nodes admitted but not yet queued
+    std::size_t dags_running_ = 0, dags_completed_ = 0, dags_failed_ = 0;
+    std::unordered_map<std::string, int> active_cases_; // queued or running, kept from the reaper
+    std::unordered_map<std::string, std::shared_ptr<CaseLog>> live_logs_; // app_id/case_id -> primary attempt
+
+    // Only touched on strand_
+    std::list<std::shared_ptr<RunningTask>> running_tasks_;
+    std::unordered_map<std::string, StreamingQuantile> runtimes_; // simulator/version -> seconds
+
+    // /proc/meminfo is re-read at most every 200ms; called with mutex_ held.
+    bool memory_low()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - memory_checked_ > std::chrono::milliseconds(200))
+        {
+            long available = available_memory_mb();
+            memory_low_ = available >= 0 && available < min_available_memory_mb;
+            memory_checked_ = now;
+        }
+        return memory_low_;
+    }
+
+    static std::uintmax_t input_size(const SimulationTask& task)
+    {
+        std::error_code ec;
+        auto size = fs::file_size(task.inputfile, ec);
+        return ec ? 0 : size;
+    }
+
+    static ResourceUsage usage_of(const ProcessSupervisor::Exit& exit, clock::time_point started)
+    {
+        auto us = [](const timeval& tv) { return std::uint64_t(tv.tv_sec) * 1000000 + std::uint64_t(tv.tv_usec); };
+        return {
+            std::uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - started).count()),
+            us(exit.usage.ru_utime),
+            us(exit.usage.ru_stime),
+            std::uint64_t(exit.usage.ru_maxrss),
+            exit.read_chars,
+            exit.write_chars,
+            std::uint64_t(exit.usage.ru_nvcsw),
+            std::uint64_t(exit.usage.ru_nivcsw),
+        };
+    }
+
+    // Inserts entry in shortest-expected-job-first order with aging: at time t an entry's priority is
+    // estimate - sejf_aging * (t - arrival), so ordering by estimate + sejf_aging * arrival gives the
+    // same order at every t. Returns the expected seconds until the entry finishes (the estimates
+    // queued ahead of it spread over the slots, plus its own), nullopt without history. Called with
+    // mutex_ held.
+    std::optional<double> enqueue(Entry entry)
+    {
+        auto estimate = history_.predict(entry.task.simulator, entry.task.version, entry.input_bytes);
+        double arrival = std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+        entry.estimate = estimate.value_or(0.0);
+        entry.order_key = sejf_enabled ? entry.estimate + sejf_aging * arrival : arrival;
+        auto pos = std::upper_bound(queue_.begin(), queue_.end(), entry.order_key,
+                                    [](double key, const Entry& e) { return key < e.order_key; });
+        double ahead = 0;
+        for (auto it = queue_.begin(); it != pos; ++it)
+            ahead += it->estimate;
+        queue_.insert(pos, std::move(entry));
+        if (!estimate)
+            return std::nullopt;
+        return ahead / double(max_running_tasks) + *estimate;
+    }
+
+    static std::string case_dir_of(const std::string& outputfile)
+    {
+        return fs::path(outputfile).parent_path().lexically_normal().string();
+    }
+
+    static std::vector<std::string> numa_node_names(const std::vector<numa::Node>& nodes)
+    {
+        std::vector<std::string> names;
+        for (auto& node : nodes)
+            names.push_back("node" + std::to_string(node.id));
+        return names;
+    }
+
+    // The node an attempt of task runs on: the owner of its affinity key, or the next node on the
+    // ring with room when the owner already runs its share of max_running_tasks. -1 leaves the
+    // placement to the kernel.
+    int place(const SimulationTask& task)
+    {
+        if (numa_nodes_.size() < 2 || task.affinity.empty())
+            return -1;
+        std::size_t cpus = 0;
+        for (auto& node : numa_nodes_)
+            cpus += node.cpu_count;
+        auto order = numa_ring_.preference(task.affinity);
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t chosen = order.front();
+        for (std::size_t i : order)
+        {
+            std::size_t share = std::max<std::size_t>(1, max_running_tasks * numa_nodes_[i].cpu_count / cpus);
+            if (numa_running_[i] < share)
+            {
+                chosen = i;
+                break;
+            }
+        }
+        ++numa_running_[chosen];
+        ++numa_placed_;
+        numa_spilled_ += chosen != order.front();
+        return static_cast<int>(chosen);
+    }
+
+    // Starts an attempt of rt on the node place() picks for it. Throws if it cannot be started.
+    pid_t start_attempt(const std::shared_ptr<RunningTask>& rt, const SimulationTask& task, int output_fd,
+                        bool speculative, clock::time_point started)
+    {
+        int& node = speculative ? rt->speculative_node : rt->primary_node;
+        node = place(task);
+        std::optional<numa::ScopedPlacement> placement;
+        if (node >= 0)
+            placement.emplace(numa_nodes_[node]);
+        std::string checkpoint_file;
+        if (rt->requeue_task && !speculative)
+            checkpoint_file = (fs::path(rt->case_dir) / checkpoint_filename).string();
+        return run_simulator(supervisor_, strand_, task, output_fd, checkpoint_file,
+            [this, rt, speculative, started](int code, const ProcessSupervisor::Exit* exit)
+            { on_attempt_exit(rt, speculative, started, code, exit); });
+    }
+
+    static std::string runtime_key(const SimulationTask& task)
+    {
+        return task.simulator + "/" + task.version;
+    }
+
+    static std::string speculative_output(const SimulationTask& task)
+    {
+        return task.outputfile + speculative_output_suffix;
+    }
+
+    // Inputs already in local scratch, such as handed-off DAG outputs, are not worth a prefetch.
+    static bool prefetchable(const SimulationTask& task)
+    {
+        return prefetch_enabled && !task.inputfile.empty() && task.inputfile.rfind(scratch_dir.string(), 0) != 0;
+    }
+
+    // Accounts for the prefetch of a task being launched and adapts the depth: a task at position k
+    // launches about k launch intervals from now, so the prefetch has to be issued at least
+    // latency / interval positions ahead. Tasks that never waited had no prefetch and are not
+    // counted. Called with mutex_ held.
+    void note_launch(const Entry& entry)
+    {
+        if (entry.prefetched)
+            ++(entry.prefetched->load() ? prefetch_hits_ : prefetch_late_);
+
+        auto now = clock::now();
+        if (!queue_.empty() && last_launch_ != clock::time_point{})
+            launch_interval_.add(std::chrono::duration<double>(now - last_launch_).count());
+        last_launch_ = now;
+        if (prefetch_latency_.count() && launch_interval_.count())
+        {
+            double ahead = std::ceil(prefetch_latency_.value() / std::max(launch_interval_.value(), 1e-3)) + 1;
+            prefetch_depth_ = static_cast<std::size_t>(std::clamp(ahead, double(prefetch_min_depth), double(prefetch_max_depth)));
+        }
+    }
+
+    // Marks the inputs within the prefetch depth that have not been prefetched yet and returns them.
+    // Called with mutex_ held.
+    std::vector<std::pair<std::string, std::shared_ptr<std::atomic<bool>>>> claim_prefetches()
+    {
+        std::vector<std::pair<std::string, std::shared_ptr<std::atomic<bool>>>> claimed;
+        std::size_t depth = std::min(prefetch_depth_, queue_.size());
+        for (std::size_t i = 0; i < depth; ++i)
+        {
+            auto& entry = queue_[i];
+            if (entry.prefetched || !prefetchable(entry.task))
+                continue;
+            entry.prefetched = std::make_shared<std::atomic<bool>>(false);
+            claimed.emplace_back(entry.task.inputfile, entry.prefetched);
+            ++prefetch_issued_;
+        }
+        return claimed;
+    }
+
+    void prefetch(const std::string& file, const std::shared_ptr<std::atomic<bool>>& done)
+    {
+        net::post(prefetch_pool_, [this, file, done]
+        {
+            auto start = clock::now();
+            std::size_t bytes = 0;
+            bool ok = true;
+            try
+            {
+                bytes = prefetch_file(file, prefetch_max_bytes);
+            }
+            catch (const std::exception& e)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Prefetch of {} failed: {}", file, e.what());
+                ok = false;
+            }
+            done->store(true);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ok)
+            {
+                prefetch_latency_.add(std::chrono::duration<double>(clock::now() - start).count());
+                prefetch_bytes_ += bytes;
+            }
+            else
+                ++prefetch_failed_;
+        });
+    }
+
+    void launch_ready()
+    {
+        for (;;)
+        {
+            Entry entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (running_ >= max_running_tasks || queue_.empty())
+                {
+                    auto claimed = claim_prefetches();
+                    for (auto& [file, done] : claimed)
+                        prefetch(file, done);
+                    return;
+                }
+                entry = std::move(queue_.front());
+                queue_.pop_front();
+                ++running_;
+                note_launch(entry);
+            }
+            tracer.span("queue", entry.task.trace_id, entry.received_us, Tracer::now_us());
+
+            auto rt = std::make_shared<RunningTask>();
+            rt->task = std::move(entry.task);
+            rt->on_complete = std::move(entry.on_complete);
+            rt->case_dir = std::move(entry.case_dir);
+            rt->input_bytes = entry.input_bytes;
+            rt->outstanding = 1;
+            if (preemption_enabled && simulator_checkpointable(rt->task.simulator, rt->task.version))
+                rt->requeue_task = rt->task;
+            running_tasks_.push_back(rt);
+
+            if (rt->task.codec.empty())
+                start_primary(rt);
+            else if (simulator_accepts_zstd(rt->task.simulator, rt->task.version))
+            {
+                rt->task.outputfile += compression::zstd_extension;
+                start_primary(rt);
+            }
+            else
+                stage_input(rt);
+        }
+    }
+
+    // The output of an attempt goes to the case directory on NFS, also for staged tasks.
+    std::shared_ptr<CaseLog> open_log(const std::shared_ptr<RunningTask>& rt, bool speculative)
+    {
+        fs::path file = fs::path(rt->case_dir) / case_log_filename;
+        if (speculative)
+            file += speculative_output_suffix;
+        return std::make_shared<CaseLog>(ioc_, file, staging_pool_.get_executor(), case_log_buffer_bytes, case_log_max_bytes);
+    }
+
+    // The primary attempt's log answers live queries until the simulator closed its output.
+    void start_primary_log(const std::shared_ptr<RunningTask>& rt, const std::shared_ptr<CaseLog>& log)
+    {
+        std::string key = rt->task.app_id + "/" + rt->task.case_id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            live_logs_[key] = log;
+        }
+        log->start([this, key, raw = log.get()]
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = live_logs_.find(key);
+            if (it != live_logs_.end() && it->second.get() == raw)
+                live_logs_.erase(it);
+        });
+    }
+
+    void start_primary(const std::shared_ptr<RunningTask>& rt)
+    {
+        rt->started = clock::now();
+        try
+        {
+            auto log = open_log(rt, false);
+            rt->primary_pid = start_attempt(rt, rt->task, log->child_fd(), false, rt->started);
+            start_primary_log(rt, log);
+        }
+        catch (const std::exception& e)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to start simulator for {}: {}", rt->task.case_id, e.what());
+            net::post(strand_, [this, rt, started = rt->started] { on_attempt_exit(rt, false, started, -1); });
+        }
+    }
+
+    // For simulators that only read plain files: decompress the input into a scratch directory on
+    // local disk and let the simulator write its output there; finish() compresses it onto NFS.
+    void stage_input(const std::shared_ptr<RunningTask>& rt)
+    {
+        rt->scratch = scratch_dir / rt->task.app_id / rt->task.simulator / rt->task.version / rt->task.case_id;
+        rt->nfs_outputfile = rt->task.outputfile + compression::zstd_extension;
+        net::post(staging_pool_, [this, rt]
+        {
+            auto start_us = Tracer::now_us();
+            fs::path input = rt->scratch / fs::path(rt->task.inputfile).filename().replace_extension();
+            bool ok = true;
+            try
+            {
+                fs::create_directories(rt->scratch);
+                compression::decompress_file(rt->task.inputfile, input, zstd_options.dictionary);
+            }
+            catch (const std::exception& e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Stage input of {} failed: {}", rt->task.case_id, e.what());
+                ok = false;
+            }
+            tracer.span("stage_input", rt->task.trace_id, start_us, Tracer::now_us());
+
+            net::post(strand_, [this, rt, ok, input]
+            {
+                rt->task.inputfile = input.string();
+                rt->task.outputfile = (rt->scratch / output_filename).string();
+                if (ok)
+                    start_primary(rt);
+                else
+                    on_attempt_exit(rt, false, clock::now(), -1);
+            });
+        });
+    }
+
+    void on_attempt_exit(const std::shared_ptr<RunningTask>& rt, bool speculative, clock::time_point started, int code,
+                         const ProcessSupervisor::Exit* exit = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --running_;
+            int& node = speculative ? rt->speculative_node : rt->primary_node;
+            if (node >= 0)
+                --numa_running_[node];
+            node = -1;
+        }
+        --rt->outstanding;
+        (speculative ? rt->speculative_pid : rt->primary_pid) = -1;
+
+        if (code == checkpoint_exit_code)
+        {
+            if (!speculative && rt->preempt_requested && !rt->reported && rt->outstanding == 0)
+            {
+                requeue(rt);
+                launch_ready();
+                return;
+            }
+            code = -1;
+        }
+
+        if (!rt->reported && (code == 0 || rt->outstanding == 0))
+        {
+            rt->reported = true;
+            if (exit)
+                rt->usage = usage_of(*exit, started);
+            if (code == 0)
+            {
+                double seconds = std::chrono::duration<double>(clock::now() - started).count();
+                runtimes_.try_emplace(runtime_key(rt->task), speculation_percentile).first->second.add(seconds);
+                if (rt->usage)
+                {
+                    auto& u = *rt->usage;
+                    history_.record({rt->task.simulator, rt->task.version, rt->input_bytes, seconds,
+                                     double(u.user_us + u.sys_us) / 1e6, long(u.max_rss_kb), Tracer::now_us() / 1000000,
+                                     u.read_bytes, u.write_bytes, u.voluntary_ctxsw, u.involuntary_ctxsw});
+                }
+
+                // The winner's output must end up at the regular path; stop the other attempt.
+                std::error_code ec;
+                if (speculative)
+                {
+                    fs::rename(speculative_output(rt->task), rt->task.outputfile, ec);
+                    if (ec)
+                    {
+                        SPDLOG_LOGGER_ERROR(Logger::instance(), "Publish speculative output of {} failed: {}", rt->task.case_id, ec.message());
+                        code = -1;
+                    }
+                }
+                pid_t loser = speculative ? rt->primary_pid : rt->speculative_pid;
+                if (loser > 0)
+                {
+                    SPDLOG_LOGGER_INFO(Logger::instance(), "{}: {} attempt won, killing pid {}",
+                                       rt->task.case_id, speculative ? "speculative" : "primary", loser);
+                    supervisor_.signal(loser, SIGKILL);
+                }
+                if (code == 0 && speculative)
+                {
+                    rt->speculative_won = true;
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ++speculation_wins_;
+                }
+            }
+
+            if (code == 0 && !rt->scratch.empty())
+                finish(rt);
+            else
+                report(rt, code);
+        }
+
+        release(rt);
+        launch_ready();
+    }
+
+    // Compresses a staged task's output from scratch onto NFS before reporting it.
+    void finish(const std::shared_ptr<RunningTask>& rt)
+    {
+        rt->finishing = true;
+        net::post(staging_pool_, [this, rt]
+        {
+            auto start_us = Tracer::now_us();
+            int code = 0;
+            try
+            {
+                compression::compress_file(rt->task.outputfile, rt->nfs_outputfile, zstd_options);
+            }
+            catch (const std::exception& e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Compress output of {} failed: {}", rt->task.case_id, e.what());
+                code = -1;
+            }
+            tracer.span("compress_output", rt->task.trace_id, start_us, Tracer::now_us());
+
+            net::post(strand_, [this, rt, code]
+            {
+                rt->finishing = false;
+                report(rt, code);
+                release(rt);
+            });
+        });
+    }
+
+    void report(const std::shared_ptr<RunningTask>& rt, int code)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++(code == 0 ? completed_ : failed_);
+        }
+        rt->on_complete(code, rt->usage);
+    }
+
+    // Forgets a task once no attempt runs and its output is published.
+    void release(const std::shared_ptr<RunningTask>& rt)
+    {
+        if (rt->outstanding != 0 || rt->finishing)
+            return;
+        std::error_code ec;
+        fs::remove(speculative_output(rt->task), ec); // leftover of a losing duplicate
+        remove_speculative_log(rt);
+        if (!rt->scratch.empty())
+            fs::remove_all(rt->scratch, ec);
+        if (rt->requeue_task)
+            fs::remove(fs::path(rt->case_dir) / checkpoint_filename, ec);
+        running_tasks_.remove(rt);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        release_case(rt->case_dir);
+    }
+
+    // Queues a task that checkpointed on request again, behind the tasks waiting now. Its case stays
+    // active, and its checkpoint is kept for the next run.
+    void requeue(const std::shared_ptr<RunningTask>& rt)
+    {
+        SPDLOG_LOGGER_INFO(Logger::instance(), "{} checkpointed, queued again", rt->task.case_id);
+        std::error_code ec;
+        if (!rt->scratch.empty())
+            fs::remove_all(rt->scratch, ec);
+        running_tasks_.remove(rt);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++preemptions_checkpointed_;
+        enqueue({std::move(*rt->requeue_task), Tracer::now_us(), std::move(rt->on_complete), rt->case_dir, rt->input_bytes});
+    }
+
+    // Called with mutex_ held.
+    // A losing duplicate's log goes once both the attempt and its log are done with; the winner's
+    // stays next to the output it produced.
+    void remove_speculative_log(const std::shared_ptr<RunningTask>& rt)
+    {
+        if (rt->speculative_log_open || rt->outstanding != 0 || rt->speculative_won)
+            return;
+        fs::path file = fs::path(rt->case_dir) / case_log_filename;
+        file += speculative_output_suffix;
+        std::error_code ec;
+        fs::remove(file, ec);
+        fs::remove(CaseLog::rotated(file), ec);
+    }
+
+    void release_case(const std::string& case_dir)
+    {
+        auto it = active_cases_.find(case_dir);
+        if (it != active_cases_.end() && --it->second == 0)
+        {
+            active_cases_.erase(it);
+            net::post(staging_pool_, [case_dir] {
+                std::error_code ec;
+                fs::remove(fs::path(case_dir) / case_lease_filename, ec);
+            });
+        }
+    }
+
+    // Creates or renews the lease of case_dir (see case_lease_filename); quietly does nothing if the
+    // directory is gone.
+    static void touch_lease(const std::string& case_dir)
+    {
+        int fd = ::open((fs::path(case_dir) / case_lease_filename).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return;
+        ::futimens(fd, nullptr);
+        ::close(fd);
+    }
+
+    // Renews the leases of all queued and running cases on the staging pool, off the strand.
+    void schedule_lease_refresh()
+    {
+        lease_timer_.expires_after(std::chrono::seconds(case_lease_refresh_seconds));
+        lease_timer_.async_wait([this](beast::error_code ec)
+        {
+            if (ec)
+                return;
+            std::vector<std::string> dirs;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                dirs.reserve(active_cases_.size());
+                for (auto& [dir, count] : active_cases_)
+                    dirs.push_back(dir);
+            }
+            net::post(staging_pool_, [dirs = std::move(dirs)] {
+                for (auto& dir : dirs)
+                    touch_lease(dir);
+            });
+            schedule_lease_refresh();
+        });
+    }
+
+    std::shared_ptr<DagRun> make_dag_run(const SimulationDag& dag, std::int64_t received_us,
+                                         std::function<void(const DagResult&)> on_complete)
+    {
+        auto run = std::make_shared<DagRun>();
+        run->app_id = dag.app_id;
+        run->dag_id = dag.dag_id;
+        run->trace_id = dag.trace_id;
+        run->received_us = received_us;
+        run->on_complete = std::move(on_complete);
+        run->unfinished = dag.nodes.size();
+        if (dag_local_handoff)
+            run->scratch = scratch_dir / "dags" / dag.app_id / dag.dag_id;
+
+        std::unordered_map<std::string, std::size_t> index;
+        for (auto& task : dag.nodes)
+        {
+            index.emplace(task.case_id, run->nodes.size());
+            DagRun::Node node;
+            node.task = task;
+            node.nfs_outputfile = task.outputfile;
+            node.case_dir = case_dir_of(task.outputfile);
+            run->nodes.push_back(std::move(node));
+        }
+
+        // A node fed locally reads all its files from <scratch>/<case_id>/in, its own input included.
+        auto local_input = [&](std::size_t i, const fs::path& nfs_file)
+        {
+            auto& node = run->nodes[i];
+            return run->scratch / node.task.case_id / "in" / nfs_file.lexically_relative(node.case_dir);
+        };
+        for (auto& edge : dag.edges)
+        {
+            std::size_t child = index.at(edge.to);
+            auto& node = run->nodes[child];
+            fs::path nfs_inputfile = fs::path(dag.nodes[child].inputfile).lexically_normal();
+            fs::path file = edge.inputfile.empty() ? nfs_inputfile : (fs::path(node.case_dir) / edge.inputfile).lexically_normal();
+            if (!run->scratch.empty())
+            {
+                if (file == nfs_inputfile)
+                    node.task.inputfile = local_input(child, file).string();
+                file = local_input(child, file);
+            }
+            run->nodes[index.at(edge.from)].outputs.push_back({child, file});
+            ++node.waiting;
+        }
+        for (std::size_t i = 0; i < run->nodes.size(); ++i)
+        {
+            auto& node = run->nodes[i];
+            if (run->scratch.empty())
+                continue;
+            if (!node.outputs.empty())
+                node.task.outputfile = (run->scratch / node.task.case_id / "out" / output_filename).string();
+            if (node.waiting > 0 && node.task.inputfile == dag.nodes[i].inputfile)
+            {
+                node.nfs_inputfile = node.task.inputfile;
+                node.task.inputfile = local_input(i, fs::path(node.nfs_inputfile).lexically_normal()).string();
+            }
+        }
+        return run;
+    }
+
+    // Creates the directories that outputs are written and handed over to, copies the inputs that
+    // are read locally, then queues the roots.
+    void prepare_dag(const std::shared_ptr<DagRun>& run)
+    {
+        net::post(staging_pool_, [this, run]
+        {
+            std::error_code ec;
+            for (auto& node : run->nodes)
+            {
+                fs::create_directories(node.case_dir, ec);
+                fs::create_directories(fs::path(node.task.outputfile).parent_path(), ec);
+                for (auto& output : node.outputs)
+                    fs::create_directories(output.file.parent_path(), ec);
+                if (!node.nfs_inputfile.empty())
+                {
+                    fs::create_directories(fs::path(node.task.inputfile).parent_path(), ec);
+                    fs::copy_file(node.nfs_inputfile, node.task.inputfile, fs::copy_options::overwrite_existing, ec);
+                }
+            }
+            net::post(strand_, [this, run]
+            {
+                for (std::size_t i = 0; i < run->nodes.size(); ++i)
+                    if (run->nodes[i].waiting == 0)
+                        enqueue_dag_node(run, i);
+                launch_ready();
+            });
+        });
+    }
+
+    void enqueue_dag_node(const std::shared_ptr<DagRun>& run, std::size_t i)
+    {
+        auto& node = run->nodes[i];
+        node.state = DagRun::State::Queued;
+        auto input_bytes = input_size(node.task);
+        std::lock_guard<std::mutex> lock(mutex_);
+        --dag_waiting_;
+        enqueue({node.task, Tracer::now_us(), [this, run, i](int code, const std::optional<ResourceUsage>&) { on_dag_node_exit(run, i, code); }, node.case_dir, input_bytes});
+    }
+
+    // Links (or copies, across file systems) a finished output to where a child reads it.
+    static bool hand_off(const fs::path& output, const fs::path& file)
+    {
+        std::error_code ec;
+        fs::remove(file, ec);
+        fs::create_hard_link(output, file, ec);
+        if (ec)
+            fs::copy_file(output, file, fs::copy_options::overwrite_existing, ec);
+        if (ec)
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Hand off {} to {} failed: {}", output.string(), file.string(), ec.message());
+        return !ec;
+    }
+
+    // A node that succeeded hands its output to its children, which are queued as soon as they have
+    // all their inputs, and is then published to NFS if it was written locally.
+    void on_dag_node_exit(const std::shared_ptr<DagRun>& run, std::size_t i, int code)
+    {
+        auto& node = run->nodes[i];
+        if (code != 0 || (node.outputs.empty() && node.task.outputfile == node.nfs_outputfile))
+        {
+            finish_dag_node(run, i, code == 0 ? DagRun::State::Completed : DagRun::State::Failed);
+            return;
+        }
+        node.state = DagRun::State::HandingOff;
+        net::post(staging_pool_, [this, run, i]
+        {
+            const auto& node = run->nodes[i];
+            auto start_us = Tracer::now_us();
+            bool ok = true;
+            for (auto& output : node.outputs)
+                ok = hand_off(node.task.outputfile, output.file) && ok;
+            if (ok)
+                net::post(strand_, [this, run, i] { dag_outputs_handed_off(run, i); });
+            tracer.span("dag_handoff", run->trace_id, start_us, Tracer::now_us());
+
+            if (ok && node.task.outputfile != node.nfs_outputfile)
+            {
+                std::error_code ec;
+                fs::copy_file(node.task.outputfile, node.nfs_outputfile, fs::copy_options::overwrite_existing, ec);
+                if (ec)
+                {
+                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Publish output of {} failed: {}", node.task.case_id, ec.message());
+                    ok = false;
+                }
+            }
+            net::post(strand_, [this, run, i, ok]
+            {
+                finish_dag_node(run, i, ok ? DagRun::State::Completed : DagRun::State::Failed);
+            });
+        });
+    }
+
+    void dag_outputs_handed_off(const std::shared_ptr<DagRun>& run, std::size_t i)
+    {
+        for (auto& output : run->nodes[i].outputs)
+        {
+            auto& child = run->nodes[output.child];
+            if (child.state == DagRun::State::Waiting && --child.waiting == 0)
+                enqueue_dag_node(run, output.child);
+        }
+        launch_ready();
+    }
+
+    void finish_dag_node(const std::shared_ptr<DagRun>& run, std::size_t i, DagRun::State state)
+    {
+        run->nodes[i].state = state;
+        if (state == DagRun::State::Failed)
+            skip_descendants(run, i);
+        if (--run->unfinished == 0)
+            complete_dag(run);
+    }
+
+    // Descendants of a failed node never run; none of them can have been queued yet.
+    void skip_descendants(const std::shared_ptr<DagRun>& run, std::size_t i)
+    {
+        std::vector<std::size_t> stack{i};
+        while (!stack.empty())
+        {
+            auto& node = run->nodes[stack.back()];
+            stack.pop_back();
+            for (auto& output : node.outputs)
+            {
+                auto& child = run->nodes[output.child];
+                if (child.state != DagRun::State::Waiting)
+                    continue;
+                SPDLOG_LOGGER_INFO(Logger::instance(), "DAG {}: skip {}, {} failed", run->dag_id, child.task.case_id, node.task.case_id);
+                child.state = DagRun::State::Skipped;
+                --run->unfinished;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --dag_waiting_;
+                    release_case(child.case_dir);
+                }
+                stack.push_back(output.child);
+            }
+        }
+    }
+
+    void complete_dag(const std::shared_ptr<DagRun>& run)
+    {
+        DagResult result{run->app_id, run->dag_id, true, run->trace_id, {}};
+        for (auto& node : run->nodes)
+        {
+            bool completed = node.state == DagRun::State::Completed;
+            result.success = result.success && completed;
+            result.cases.push_back({node.task.simulator, node.task.version, node.task.case_id,
+                                    completed ? "completed" : node.state == DagRun::State::Failed ? "failed" : "skipped",
+                                    completed ? output_filename.string() : ""});
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --dags_running_;
+            ++(result.success ? dags_completed_ : dags_failed_);
+        }
+        tracer.span("dag", run->trace_id, run->received_us, Tracer::now_us());
+        SPDLOG_LOGGER_INFO(Logger::instance(), "DAG {} of app {} done, success = {}", run->dag_id, run->app_id, result.success);
+        if (!run->scratch.empty())
+            net::post(staging_pool_, [scratch = run->scratch] { std::error_code ec; fs::remove_all(scratch, ec); });
+        run->on_complete(result);
+    }
+
+    void schedule_speculation_check()
+    {
+        speculation_timer_.expires_after(std::chrono::milliseconds(speculation_check_interval_ms));
+        speculation_timer_.async_wait([this](beast::error_code ec)
+        {
+            if (ec)
+                return;
+            speculate();
+            schedule_speculation_check();
+        });
+    }
+
+    // Duplicate stragglers, oldest first, while there is idle capacity and nothing is waiting.
+    void speculate()
+    {
+        auto now = clock::now();
+        for (auto& rt : running_tasks_)
+        {
+            if (rt->reported || rt->primary_pid == -1 || rt->speculative_pid != -1 || rt->outstanding != 1 ||
+                rt->preempt_requested)
+                continue;
+            auto it = runtimes_.find(runtime_key(rt->task));
+            if (it == runtimes_.end() || it->second.count() < speculation_min_samples)
+                continue;
+            double elapsed = std::chrono::duration<double>(now - rt->started).count();
+            if (elapsed <= it->second.value())
+                continue;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (running_ >= max_running_tasks || !queue_.empty())
+                    return;
+                ++running_;
+                ++speculations_;
+            }
+
+            SPDLOG_LOGGER_INFO(Logger::instance(), "{} running {:.1f}s (p{:.0f} = {:.1f}s), starting speculative duplicate",
+                               rt->task.case_id, elapsed, speculation_percentile * 100, it->second.value());
+            SimulationTask duplicate = rt->task;
+            duplicate.outputfile = speculative_output(rt->task);
+            ++rt->outstanding;
+            try
+            {
+                auto log = open_log(rt, true);
+                rt->speculative_pid = start_attempt(rt, duplicate, log->child_fd(), true, now);
+                rt->speculative_log_open = true;
+                log->start([this, rt]
+                {
+                    net::post(strand_, [this, rt]
+                    {
+                        rt->speculative_log_open = false;
+                        remove_speculative_log(rt);
+                    });
+                });
+            }
+            catch (const std::exception& e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Failed to start speculative duplicate for {}: {}", rt->task.case_id, e.what());
+                net::post(strand_, [this, rt, now] { on_attempt_exit(rt, true, now, -1); });
+            }
+        }
+    }
+
+    void schedule_preemption_check()
+    {
+        preemption_timer_.expires_after(std::chrono::milliseconds(preempt_check_interval_ms));
+        preemption_timer_.async_wait([this](beast::error_code ec)
+        {
+            if (ec)
+                return;
+            preempt();
+            schedule_preemption_check();
+        });
+    }
+
+    // Asks the longest checkpointable run to make room once the queue head has waited
+    // preempt_after_wait_ms for a slot; one request at a time, until it exits or its grace expires.
+    void preempt()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty() || running_ < max_running_tasks ||
+                Tracer::now_us() - queue_.front().received_us < preempt_after_wait_ms * 1000)
+                return;
+        }
+        auto now = clock::now();
+        std::shared_ptr<RunningTask> victim;
+        for (auto& rt : running_tasks_)
+        {
+            if (rt->preempt_requested)
+            {
+                if (now - *rt->preempt_requested < std::chrono::seconds(checkpoint_grace_seconds))
+                    return;
+                continue;
+            }
+            if (!rt->requeue_task || rt->reported || rt->primary_pid == -1 || rt->outstanding != 1 ||
+                now - rt->started < std::chrono::seconds(preempt_min_runtime_seconds))
+                continue;
+            if (!victim || rt->started < victim->started)
+                victim = rt;
+        }
+        if (!victim || !supervisor_.signal(victim->primary_pid, SIGUSR1))
+            return;
+        victim->preempt_requested = now;
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Queue head waiting, asking {} (pid {}, running {:.0f}s) to checkpoint",
+                           victim->task.case_id, victim->primary_pid, std::chrono::duration<double>(now - victim->started).count());
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++preemptions_requested_;
+    }
+};
+
+// Enforces the retention policies (settings: RetentionPolicy) on the case directories below
+// case_root. Runs every reaper_interval_seconds on its own thread at the lowest CPU and I/O
+// priority, so a pass over a large volume never competes with simulators. A case is removed by first
+// renaming it out of the way while the scheduler guarantees it is not queued or running, then
+// unlinking it, pausing after every reaper_batch_size unlinks to keep shared storage responsive.
+// Cases that another server sharing the storage holds a live lease on are left alone.
+class CaseReaper
 {
-    std::string command = simulator_exec_command(task.simulator, task.version, task.inputfile, task.outputfile);
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Start Simulation: {}", command);
+public:
+    explicit CaseReaper(TaskScheduler& scheduler) : scheduler_(scheduler) {}
+
+    ~CaseReaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    void run()
+    {
+        if (reaper_enabled)
+            thread_ = std::thread([this] { loop(); });
+    }
+
+    // Thread-safe snapshot for the metrics endpoint.
+    json metrics()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return json{
+            {"passes"           , passes_},
+            {"reaped_cases"     , reaped_cases_},
+            {"reclaimed_bytes"  , reclaimed_bytes_},
+            {"failed"           , failed_},
+            {"last_pass_seconds", last_pass_seconds_},
+            {"lag_seconds"      , lag_seconds_},
+        };
+    }
+
+private:
+    using file_clock = fs::file_time_type::clock;
+
+    static constexpr std::string_view trash_prefix = ".reaping.";
+
+    struct Case
+    {
+        fs::path dir;
+        double age_seconds;    // since the output was written, or the directory changed
+        std::uintmax_t bytes;
+        bool finished;         // has an output
+    };
+
+    TaskScheduler& scheduler_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::size_t passes_ = 0, reaped_cases_ = 0, failed_ = 0;
+    std::uintmax_t reclaimed_bytes_ = 0;
+    double last_pass_seconds_ = 0;
+    double lag_seconds_ = 0; // how far past its max age the most overdue case of the last pass was
+    std::size_t unlinks_since_pause_ = 0; // only touched by thread_
+
+    bool stopping()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stopping_;
+    }
+
+    // Returns false once the reaper is stopping.
+    bool sleep_for(std::chrono::milliseconds duration)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !wake_.wait_for(lock, duration, [this] { return stopping_; });
+    }
+
+    void loop()
+    {
+        // Idle CPU and I/O class for this thread only (ioprio_set has no glibc wrapper).
+        pid_t tid = static_cast<pid_t>(::syscall(SYS_gettid));
+        ::setpriority(PRIO_PROCESS, tid, 19);
+        constexpr int ioprio_who_process = 1, ioprio_class_idle = 3, ioprio_class_shift = 13;
+        ::syscall(SYS_ioprio_set, ioprio_who_process, tid, ioprio_class_idle << ioprio_class_shift);
+
+        while (sleep_for(std::chrono::seconds(reaper_interval_seconds)))
+        {
+            try
+            {
+                pass();
+            }
+            catch (const std::exception& e)
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Reaper pass failed: {}", e.what());
+            }
+        }
+    }
+
+    static const RetentionPolicy& policy_of(const std::string& app_id)
+    {
+        auto it = app_retention.find(app_id);
+        return it == app_retention.end() ? default_retention : it->second;
+    }
+
+    void pass()
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t reaped = 0, failed = 0;
+        std::uintmax_t reclaimed = 0;
+        double lag = 0;
 
-    // Used to maintain the lifecycle of bp::child objects
-    static std::unordered_map<std::string, std::shared_ptr<bp::child>> active_processes;
+        std::error_code ec;
+        for (auto& app : fs::directory_iterator(case_root, ec))
+        {
+            if (!app.is_directory(ec))
+                continue;
+            const RetentionPolicy& policy = policy_of(app.path().filename().string());
+            if (policy.max_age_seconds == 0 && policy.max_cases == 0 && policy.max_bytes == 0 &&
+                policy.abandoned_max_age_seconds == 0)
+                continue;
+
+            std::vector<Case> cases;
+            std::vector<fs::path> trash;
+            for (auto& sim : fs::directory_iterator(app.path(), ec))
+                for (auto& version : fs::directory_iterator(sim.path(), ec))
+                    collect(version.path(), 0, cases, trash);
+
+            // Oldest first; every case beyond a limit is older than every case kept.
+            std::sort(cases.begin(), cases.end(),
+                      [](const Case& a, const Case& b) { return a.age_seconds > b.age_seconds; });
+            std::size_t kept_cases = 0;
+            std::uintmax_t kept_bytes = 0;
+            for (auto& c : cases)
+                if (c.finished)
+                {
+                    ++kept_cases;
+                    kept_bytes += c.bytes;
+                }
+
+            for (auto& c : cases)
+            {
+                if (stopping())
+                    return;
+                long max_age = c.finished ? policy.max_age_seconds : policy.abandoned_max_age_seconds;
+                bool expired = max_age > 0 && c.age_seconds > max_age;
+                bool over = c.finished && ((policy.max_cases > 0 && kept_cases > policy.max_cases) ||
+                                           (policy.max_bytes > 0 && kept_bytes > policy.max_bytes));
+                if (!expired && !over)
+                    continue;
+                if (expired)
+                    lag = std::max(lag, c.age_seconds - max_age);
+
+                if (leased(c.dir))
+                    continue;
+                fs::path to = c.dir.parent_path() / (std::string(trash_prefix) + c.dir.filename().string());
+                std::error_code rename_ec;
+                if (!scheduler_.unless_active(c.dir, [&] { fs::rename(c.dir, to, rename_ec); }))
+                    continue;
+                if (rename_ec || !remove(to))
+                {
+                    SPDLOG_LOGGER_WARN(Logger::instance(), "Reap {} failed: {}", c.dir.string(),
+                                       rename_ec ? rename_ec.message() : "remove");
+                    ++failed;
+                    continue;
+                }
+                SPDLOG_LOGGER_DEBUG(Logger::instance(), "Reaped {} ({} bytes)", c.dir.string(), c.bytes);
+                ++reaped;
+                reclaimed += c.bytes;
+                if (c.finished)
+                {
+                    --kept_cases;
+                    kept_bytes -= c.bytes;
+                }
+            }
+
+            // Left over by an interrupted pass
+            for (auto& dir : trash)
+                if (!remove(dir))
+                    ++failed;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (reaped || failed)
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Reaper reclaimed {} bytes of {} cases ({} failed) in {:.1f}s",
+                               reclaimed, reaped, failed, seconds);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++passes_;
+        reaped_cases_ += reaped;
+        failed_ += failed;
+        reclaimed_bytes_ += reclaimed;
+        last_pass_seconds_ = seconds;
+        lag_seconds_ = lag;
+    }
+
+    // Finds the case directories below a sweep directory, descending into the fan-out levels of
+    // case_dir_layout; legacy case directories sit directly in the sweep directory.
+    void collect(const fs::path& dir, unsigned level, std::vector<Case>& cases, std::vector<fs::path>& trash)
+    {
+        std::error_code ec;
+        for (auto& entry : fs::directory_iterator(dir, ec))
+        {
+            if (!entry.is_directory(ec))
+                continue;
+            std::string name = entry.path().filename().string();
+            if (std::string_view(name).substr(0, trash_prefix.size()) == trash_prefix)
+                trash.push_back(entry.path());
+            else if (level < case_dir_layout.levels && case_layout::is_shard_name(name, case_dir_layout))
+                collect(entry.path(), level + 1, cases, trash);
+            else if (level == case_dir_layout.levels || level == 0)
+                cases.push_back(inspect(entry.path()));
+        }
+    }
+
+    static Case inspect(const fs::path& dir)
+    {
+        Case c{dir, 0, 0, false};
+        std::error_code ec;
+        auto written = fs::last_write_time(dir / output_filename, ec);
+        if (ec)
+            written = fs::last_write_time(fs::path(dir / output_filename) += compression::zstd_extension, ec);
+        c.finished = !ec;
+        if (ec)
+            written = fs::last_write_time(dir, ec);
+        if (!ec)
+            c.age_seconds = std::chrono::duration<double>(file_clock::now() - written).count();
+        for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            if (it->is_regular_file(ec))
+                c.bytes += it->file_size(ec);
+        return c;
+    }
+
+    // Whether a server renewed the lease of the case in dir within case_lease_ttl_seconds.
+    static bool leased(const fs::path& dir)
+    {
+        std::error_code ec;
+        auto renewed = fs::last_write_time(dir / case_lease_filename, ec);
+        return !ec && file_clock::now() - renewed < std::chrono::seconds(case_lease_ttl_seconds);
+    }
 
-    // Launch process asynchronously
-    auto process = std::make_shared<bp::child>
-    (
-        command,
-        bp::std_out > stdout,
-        bp::on_exit = [strand, command, task, on_complete](int exit_code, const std::error_code& ec)
+    // Unlinks dir in rate-limited batches. False on error.
+    bool remove(const fs::path& dir)
+    {
+        std::error_code ec;
+        std::vector<fs::path> entries;
+        for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            entries.push_back(it->path());
+        if (ec)
+            return false;
+        // Children before their parents
+        entries.push_back(dir);
+        std::sort(entries.begin(), entries.end(), std::greater<>());
+        for (auto& path : entries)
         {
-            active_processes.erase(command);  // Clear
-            net::post(strand, [exit_code, ec, task, on_complete]
+            fs::remove(path, ec);
+            if (ec)
+                return false;
+            if (++unlinks_since_pause_ >= reaper_batch_size)
             {
-                if (ec)
-                {
-                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Simulator {} failed to execute: {}", task.case_id, ec.message());
-                    on_complete(-1);
-                    return;
-                }
-                SPDLOG_LOGGER_INFO(Logger::instance(), "{} Execution completed, code = {}", task.case_id, exit_code);
-                on_complete(exit_code == 0 ? 0 : -1);
-            });
-        },
-        ioc
-    );
-
-    active_processes[command] = process;
-}
+                unlinks_since_pause_ = 0;
+                if (!sleep_for(std::chrono::milliseconds(reaper_batch_pause_ms)))
+                    return false;
+            }
+        }
+        return true;
+    }
+};
 
 class Session : public std::enable_shared_from_this<Session>
 {
 public:
-    Session(tcp::socket socket, net::io_context& ioc)
+    Session(tcp::socket socket, net::io_context& ioc, TaskScheduler& scheduler, CaseReaper& reaper,
+            std::function<void(const char*)> drain)
     : ioc_(ioc),
+      scheduler_(scheduler),
+      reaper_(reaper),
+      drain_(std::move(drain)),
       stream_(std::move(socket)),
       callback_stream_(ioc),
       resolver_(ioc),
       strand_(net::make_strand(ioc)),
-      callback_strand_(net::make_strand(ioc))
+      callback_strand_(net::make_strand(ioc)),
+      callback_retry_timer_(callback_strand_)
     {
         auto remote_endpoint = stream_.socket().remote_endpoint();
         SPDLOG_LOGGER_INFO(Logger::instance(), "Get Connection: IP: {}, port: {}",
                            remote_endpoint.address().to_string(), remote_endpoint.port());
     }
 
+    // Reading starts right away; the callback connection is only opened for the first result.
     void run()
     {
-        // Upon initial connection, once the connection is successful, the system begins reading client requests.
-        connect_callback(strand_, [self = shared_from_this()]
-        {
-            if (!self->is_reading_) {
-                self->is_reading_ = true;
-                self->read_request();
-            }
-        });
+        net::dispatch(strand_, [self = shared_from_this()] { self->read_request(); });
     }
 
 private:
     net::io_context& ioc_;
+    TaskScheduler& scheduler_;
+    CaseReaper& reaper_;
+    std::function<void(const char*)> drain_; // starts draining the server; the argument says why
     beast::tcp_stream stream_; // client
     beast::tcp_stream callback_stream_;
     tcp::resolver resolver_;
     net::strand<net::io_context::executor_type> strand_; // For request handling
     net::strand<net::io_context::executor_type> callback_strand_; // For callbacks
-    beast::flat_buffer buffer_;
+    net::steady_timer callback_retry_timer_;
+    beast::flat_buffer buffer_; // may already hold the next pipelined request
     http::request<http::string_body> req_;
+    SimulationTaskView task_view_; // reused by the JSON fast path
+
+    // Responses in request order; the front one is being written. On strand_.
+    std::deque<std::shared_ptr<http::response<http::string_body>>> responses_;
+    bool is_reading_ = false;
+    bool is_writing_ = false;
+    bool read_closed_ = false; // client half-closed or sent Connection: close
+
+    // Encoded callback body; results use the same encoding as the task request they answer.
+    struct CallbackMessage
+    {
+        std::string target = request_manager_target;
+        std::string content_type;
+        std::string body;
+        std::string trace_id;
+        int attempts = 0;
+    };
+    // Results to deliver, the front one in flight while callback_busy_. On callback_strand_.
+    std::deque<CallbackMessage> pending_callbacks_;
+    bool callback_busy_ = false;
     bool callback_connected_ = false;
-    std::queue<json> pending_callbacks_; // Store callback data to be sent
-    bool is_reading_ = false; // Tracking whether client requests are being read
+    bool callback_reused_ = false; // the connection already delivered a result
 
     struct SingleEndpointConnectHandler
     {
         std::shared_ptr<Session> self;
-        std::function<void()> on_connect;
+        std::function<void(bool)> on_connect;
 
         // Use void(beast::error_code) to match the static assertion
         void operator()(beast::error_code ec)
@@ -131,19 +1670,21 @@ private:
                                     request_manager_ip, request_manager_port, ec.message());
                 self->callback_connected_ = false;
                 self->close_callback();
+                on_connect(false);
                 return;
             }
             SPDLOG_LOGGER_INFO(Logger::instance(), "Connected to callback {}:{}", request_manager_ip, request_manager_port);
             self->callback_connected_ = true;
-            on_connect();
+            self->callback_reused_ = false;
+            on_connect(true);
         }
     };
 
-    void connect_callback(net::strand<net::io_context::executor_type> on_connect_strand, std::function<void()> on_connect)
+    void connect_callback(std::function<void(bool)> on_connect)
     {
         resolver_.async_resolve(request_manager_ip, request_manager_port,
             net::bind_executor(callback_strand_,
-            [self = shared_from_this(), on_connect_strand, on_connect]
+            [self = shared_from_this(), on_connect]
             (beast::error_code ec, tcp::resolver::results_type results)
             {
                 if (ec)
@@ -151,32 +1692,41 @@ private:
                     SPDLOG_LOGGER_ERROR(Logger::instance(), "Resolve callback address {}:{} failed: {}",
                                         request_manager_ip, request_manager_port, ec.message());
                     self->callback_connected_ = false;
+                    on_connect(false);
                     return;
                 }
                 if (results.empty())
                 {
                     SPDLOG_LOGGER_ERROR(Logger::instance(), "No endpoints resolved for {}:{}", request_manager_ip, request_manager_port);
                     self->callback_connected_ = false;
+                    on_connect(false);
                     return;
                 }
                 // Use single-endpoint async_connect with simplified handler
                 self->callback_stream_.async_connect(*results.begin(),
-                    net::bind_executor(on_connect_strand, SingleEndpointConnectHandler{self, on_connect}));
+                    net::bind_executor(self->callback_strand_, SingleEndpointConnectHandler{self, on_connect}));
             }));
     }
 
+    // Reads the next request unless one is being read, the client is done sending, or
+    // max_pipelined_requests responses are still waiting; write_response() resumes reading.
     void read_request()
     {
+        if (is_reading_ || read_closed_ || responses_.size() >= max_pipelined_requests)
+            return;
+        is_reading_ = true;
         req_ = {};
-        buffer_.consume(buffer_.size());
         http::async_read(stream_, buffer_, req_,
             net::bind_executor(strand_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes_transferred)
             {
                 self->is_reading_ = false; // Read complete, reset flag.
                 if (ec == beast::http::error::end_of_stream || ec == net::error::eof)
                 {
+                    // Still answer the requests read so far.
                     SPDLOG_LOGGER_WARN(Logger::instance(), "Client closed connection");
-                    self->close_client();
+                    self->read_closed_ = true;
+                    if (self->responses_.empty())
+                        self->close_client();
                     return;
                 }
                 if (ec == net::error::connection_reset || ec == net::error::connection_aborted)
@@ -191,32 +1741,60 @@ private:
                     self->close_client();
                     return;
                 }
+                capture.record(self->req_.method_string(), self->req_.target(),
+                               self->req_[http::field::content_type], self->req_.body());
                 SPDLOG_LOGGER_INFO(Logger::instance(), "Got request: {} {}, bytes: {}",
                                    std::string(self->req_.method_string()), std::string(self->req_.target()), bytes_transferred);
-                SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", self->req_.body());
+                if (wire::is_wire(self->req_[http::field::content_type]))
+                    SPDLOG_LOGGER_INFO(Logger::instance(), "body: {} bytes (wire)", self->req_.body().size());
+                else
+                    SPDLOG_LOGGER_INFO(Logger::instance(), "body: {}", self->req_.body());
                 SPDLOG_LOGGER_INFO(Logger::instance(), "keep alive: {}", self->req_.keep_alive());
+                if (!self->req_.keep_alive())
+                    self->read_closed_ = true;
                 self->handle_request();
+                self->read_request(); // read ahead while the response is written
             }));
     }
 
     void handle_request()
     {
+        auto received_us = Tracer::now_us();
         if (req_.method() == http::verb::post && req_.target() == sim_server_target)
         {
-            // Parse JSON body
+            // Parse body, JSON unless the client sent the binary wire encoding
             SimulationTask task;
+            bool use_wire = wire::is_wire(req_[http::field::content_type]);
             try
             {
-                json j = json::parse(req_.body());
-                task = j.get<SimulationTask>();
+                if (use_wire)
+                    from_wire(req_.body(), task);
+                else if (parse_task(req_.body(), task_view_))
+                    assign_task(task_view_, task);
+                else
+                    task = json::parse(req_.body()).get<SimulationTask>();
             }
             catch (const std::exception& e)
             {
-                SPDLOG_LOGGER_ERROR(Logger::instance(), "JSON parse error: {}", e.what());
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Request body parse error: {}", e.what());
+                auto res = std::make_shared<http::response<http::string_body>>(http::status::bad_request, req_.version());
+                res->set(http::field::content_type, "application/json");
+                res->keep_alive(req_.keep_alive());
+                res->body() = error_response_body(use_wire ? "Invalid wire request body" : "Invalid JSON request body");
+                res->prepare_payload();
+                write_response(res);
+                return;
+            }
+
+            apply_legacy_layout_fallback(task);
+
+            if (!compression::is_supported(task.codec))
+            {
+                SPDLOG_LOGGER_ERROR(Logger::instance(), "Unsupported codec: {}", task.codec);
                 auto res = std::make_shared<http::response<http::string_body>>(http::status::bad_request, req_.version());
                 res->set(http::field::content_type, "application/json");
                 res->keep_alive(req_.keep_alive());
-                res->body() = error_response_body("Invalid JSON request body");
+                res->body() = error_response_body("Unsupported codec");
                 res->prepare_payload();
                 write_response(res);
                 return;
@@ -234,16 +1812,60 @@ private:
                 return;
             }
 
-            // Respond to the client immediately
+            // Queue the task, then respond to the client immediately
+            std::optional<double> eta;
+            auto admission = handle_new_task(task, use_wire, received_us, eta);
+            if (admission != TaskScheduler::Admission::Accepted)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Reject {}: {}", task.case_id, rejection_reason(admission));
+                auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, req_.version());
+                res->set(http::field::content_type, "application/json");
+                res->keep_alive(req_.keep_alive());
+                reject(*res, admission);
+                res->prepare_payload();
+                write_response(res);
+                return;
+            }
+
             auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, req_.version());
             res->set(http::field::content_type, "application/json");
             res->keep_alive(req_.keep_alive());
-            res->body() = message_response_body("Request received");
+            json body = {{"status", "Request received"}};
+            if (eta)
+                body["eta_seconds"] = *eta;
+            res->body() = body.dump();
+            res->prepare_payload();
+            write_response(res);
+        }
+        else if (req_.method() == http::verb::post && req_.target() == sim_server_dag_target)
+        {
+            handle_dag(received_us);
+        }
+        else if (req_.method() == http::verb::get && req_.target().starts_with(cases_target))
+        {
+            handle_case_logs();
+        }
+        else if (req_.method() == http::verb::post && req_.target() == drain_target)
+        {
+            auto res = std::make_shared<http::response<http::string_body>>(http::status::accepted, req_.version());
+            res->set(http::field::content_type, "application/json");
+            res->keep_alive(false);
+            res->body() = message_response_body("Draining");
+            res->prepare_payload();
+            read_closed_ = true;
+            write_response(res);
+            drain_("admin request");
+        }
+        else if (req_.method() == http::verb::get && req_.target() == metrics_target)
+        {
+            auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, req_.version());
+            res->set(http::field::content_type, "application/json");
+            res->keep_alive(req_.keep_alive());
+            json metrics = scheduler_.metrics();
+            metrics["reaper"] = reaper_.metrics();
+            res->body() = metrics.dump();
             res->prepare_payload();
             write_response(res);
-
-            // Submit external program to execute task
-            handle_new_task(task);
         }
         else
         {
@@ -257,9 +1879,125 @@ private:
         }
     }
 
-    void write_response(std::shared_ptr<http::response<http::string_body>> res) {
+    // POST <sim_server_dag_target>, JSON only. Answered like a single task; the DagResult follows
+    // once every node is done.
+    void handle_dag(std::int64_t received_us)
+    {
+        auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, req_.version());
+        res->set(http::field::content_type, "application/json");
+        res->keep_alive(req_.keep_alive());
+
+        SimulationDag dag;
+        std::string error;
+        try
+        {
+            dag = json::parse(req_.body()).get<SimulationDag>();
+            error = validate_dag(dag);
+        }
+        catch (const std::exception& e)
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "DAG body parse error: {}", e.what());
+            error = "Invalid JSON request body";
+        }
+
+        TaskScheduler::Admission admission = TaskScheduler::Admission::Accepted;
+        if (error.empty())
+        {
+            ++undelivered_results;
+            admission = scheduler_.submit_dag(dag, received_us, [self = shared_from_this()](const DagResult& result)
+            {
+                net::post(self->callback_strand_, [self, result] { self->send_dag_result(result); });
+            });
+            if (admission != TaskScheduler::Admission::Accepted)
+                --undelivered_results;
+        }
+
+        if (!error.empty())
+        {
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Reject DAG {}: {}", dag.dag_id, error);
+            res->result(http::status::bad_request);
+            res->body() = error_response_body(error);
+        }
+        else if (admission != TaskScheduler::Admission::Accepted)
+        {
+            SPDLOG_LOGGER_WARN(Logger::instance(), "Reject DAG {}: {}", dag.dag_id, rejection_reason(admission));
+            reject(*res, admission);
+        }
+        else
+            res->body() = message_response_body("DAG received");
+        res->prepare_payload();
+        write_response(res);
+    }
+
+    // GET <cases_target><app_id>/<case_id>/logs[?tail=<lines>]
+    void handle_case_logs()
+    {
+        std::string_view full_target(req_.target().data(), req_.target().size());
+        std::string_view target = target_path(full_target);
+        target.remove_prefix(cases_target.size());
+
+        std::vector<std::string> parts;
+        for (std::size_t pos = 0; pos <= target.size();)
+        {
+            std::size_t end = std::min(target.find('/', pos), target.size());
+            parts.emplace_back(target.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        auto valid = [](const std::string& part) { return !part.empty() && part != "." && part != ".."; };
+        std::size_t tail = 0;
+        bool ok = parts.size() == 3 && valid(parts[0]) && valid(parts[1]) && parts[2] == "logs";
+        if (auto value = query_param(full_target, "tail"); ok && value)
+        {
+            auto [p, ec] = std::from_chars(value->data(), value->data() + value->size(), tail);
+            ok = ec == std::errc() && p == value->data() + value->size();
+        }
+
+        auto res = std::make_shared<http::response<http::string_body>>(http::status::ok, req_.version());
+        res->keep_alive(req_.keep_alive());
+        std::shared_ptr<CaseLog> live;
+        fs::path file;
+        if (!ok)
+        {
+            res->result(http::status::bad_request);
+            res->set(http::field::content_type, "application/json");
+            res->body() = error_response_body("Invalid case log request");
+        }
+        else if ((live = scheduler_.live_log(parts[0], parts[1])))
+        {
+            res->set(http::field::content_type, "text/plain; charset=utf-8");
+            res->body() = live->tail(tail);
+        }
+        else if (!(file = find_case_log(parts[0], parts[1])).empty())
+        {
+            res->set(http::field::content_type, "text/plain; charset=utf-8");
+            res->body() = CaseLog::read_tail(file, tail);
+        }
+        else
+        {
+            res->result(http::status::not_found);
+            res->set(http::field::content_type, "application/json");
+            res->body() = error_response_body("Case log not found");
+        }
+        res->prepare_payload();
+        write_response(res);
+    }
+
+    // Queues res behind the responses to earlier requests.
+    void write_response(std::shared_ptr<http::response<http::string_body>> res)
+    {
+        responses_.push_back(std::move(res));
+        write_next_response();
+    }
+
+    void write_next_response()
+    {
+        if (is_writing_ || responses_.empty())
+            return;
+        is_writing_ = true;
+        auto res = responses_.front();
         http::async_write(stream_, *res,
             net::bind_executor(strand_, [self = shared_from_this(), res](beast::error_code ec, std::size_t) {
+                self->is_writing_ = false;
                 if (ec == net::error::connection_reset || ec == net::error::connection_aborted) {
                     SPDLOG_LOGGER_ERROR(Logger::instance(), "Client connection error: {}", ec.message());
                     self->close_client();
@@ -271,132 +2009,208 @@ private:
                     return;
                 }
                 SPDLOG_LOGGER_INFO(Logger::instance(), "Response sent");
-                if (res->keep_alive() && !self->is_reading_) {
-                    self->is_reading_ = true;
-                    self->read_request();
-                } else if (!res->keep_alive()) {
+                self->responses_.pop_front();
+                if (!res->keep_alive() || (self->read_closed_ && self->responses_.empty())) {
                     self->close_client();
+                    return;
                 }
+                self->write_next_response();
+                self->read_request();
             }));
     }
 
-    void handle_new_task(const SimulationTask& task)
+    TaskScheduler::Admission handle_new_task(const SimulationTask& task, bool use_wire, std::int64_t received_us,
+                                             std::optional<double>& eta)
+    {
+        ++undelivered_results;
+        auto admission = scheduler_.submit(task, received_us,
+            [self = shared_from_this(), task, use_wire](int code, const std::optional<ResourceUsage>& usage) {
+                net::post(self->callback_strand_, [self, task, use_wire, code, usage] { self->send_result(task, use_wire, code, usage); });
+            }, eta);
+        if (admission != TaskScheduler::Admission::Accepted)
+            --undelivered_results;
+        return admission;
+    }
+
+    static const char* rejection_reason(TaskScheduler::Admission admission)
+    {
+        switch (admission)
+        {
+        case TaskScheduler::Admission::QueueFull: return "Queue full";
+        case TaskScheduler::Admission::LowMemory: return "Insufficient memory";
+        default:                                  return "Draining";
+        }
+    }
+
+    // 429 when the queue is full, otherwise 503, with a Retry-After hint. A draining server also
+    // closes the connection, so that the client's retry reaches the server that took over the port.
+    void reject(http::response<http::string_body>& res, TaskScheduler::Admission admission)
+    {
+        res.result(admission == TaskScheduler::Admission::QueueFull ? http::status::too_many_requests
+                                                                    : http::status::service_unavailable);
+        res.set(http::field::retry_after, std::to_string(retry_after_seconds));
+        res.body() = error_response_body(rejection_reason(admission));
+        if (admission == TaskScheduler::Admission::Draining)
+        {
+            res.keep_alive(false);
+            read_closed_ = true;
+        }
+    }
+
+    void send_result(const SimulationTask& task, bool use_wire, int code, const std::optional<ResourceUsage>& usage)
+    {
+        SimulationResult sim_result
+        {
+            task.simulator,
+            task.version,
+            task.app_id,
+            task.case_id,
+            task.codec.empty() ? output_filename.string() : output_filename.string() + compression::zstd_extension,
+            code == 0,
+            task.trace_id,
+            task.codec,
+            usage
+        };
+        CallbackMessage message;
+        message.trace_id = task.trace_id;
+        if (use_wire)
+        {
+            message.content_type = wire_content_type;
+            to_wire(message.body, sim_result);
+        }
+        else
+        {
+            message.content_type = json_content_type;
+            write_result(message.body, sim_result);
+        }
+        send_callback(message);
+    }
+
+    void send_dag_result(const DagResult& result)
     {
-        run_simulator(ioc_, callback_strand_, task, [self = shared_from_this(), task](int code) {
-            json sim_result = SimulationResult
+        CallbackMessage message;
+        message.target = request_manager_dag_target;
+        message.content_type = json_content_type;
+        message.body = json(result).dump();
+        message.trace_id = result.trace_id;
+        send_callback(message);
+    }
+
+    void send_callback(CallbackMessage message)
+    {
+        pending_callbacks_.push_back(std::move(message));
+        flush_callbacks();
+    }
+
+    // Delivers the pending results one at a time, (re)connecting first when needed.
+    void flush_callbacks()
+    {
+        if (callback_busy_ || pending_callbacks_.empty())
+            return;
+        callback_busy_ = true;
+        if (callback_connected_)
+        {
+            write_callback(pending_callbacks_.front());
+            return;
+        }
+        connect_callback([self = shared_from_this()](bool ok)
+        {
+            if (!ok)
             {
-                task.simulator,
-                task.version,
-                task.app_id,
-                task.case_id,
-                output_filename,
-                code == 0
-            };
-            self->send_callback(sim_result);
+                self->retry_callback();
+                return;
+            }
+            self->write_callback(self->pending_callbacks_.front());
         });
     }
 
-    void send_callback(const json& response_body) {
-        if (callback_connected_)
+    // The front result was not delivered: try again later, or give up on it.
+    void retry_callback()
+    {
+        auto& message = pending_callbacks_.front();
+        if (++message.attempts >= callback_max_attempts)
         {
-            write_callback(response_body);
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Dropping result after {} attempts: {}", message.attempts, message.body);
+            pop_callback();
         }
+        callback_retry_timer_.expires_after(std::chrono::milliseconds(callback_retry_ms));
+        callback_retry_timer_.async_wait([self = shared_from_this()](beast::error_code)
+        {
+            self->callback_busy_ = false;
+            self->flush_callbacks();
+        });
     }
 
-    void reconnect_callback_and_write()
+    void pop_callback()
     {
-        connect_callback(callback_strand_, [self = shared_from_this()] { self->pop_callback_response_and_write(); });
+        pending_callbacks_.pop_front();
+        --undelivered_results;
     }
 
-    void pop_callback_response_and_write()
+    void callback_delivered()
     {
-        if (!pending_callbacks_.empty())
+        pop_callback();
+        callback_reused_ = true;
+        callback_busy_ = false;
+        flush_callbacks();
+    }
+
+    void callback_failed(const char* what, beast::error_code ec, bool retry)
+    {
+        SPDLOG_LOGGER_ERROR(Logger::instance(), "Callback {} failed: {}", what, ec.message());
+        callback_connected_ = false;
+        close_callback();
+        if (retry)
+            retry_callback();
+        else
         {
-            auto response_body = std::move(pending_callbacks_.front());
-            pending_callbacks_.pop();
-            write_callback(response_body);
+            SPDLOG_LOGGER_ERROR(Logger::instance(), "Result may not have been delivered: {}", pending_callbacks_.front().body);
+            pop_callback();
+            callback_busy_ = false;
+            flush_callbacks();
         }
     }
 
-    void write_callback(const json& response_body)
+    void write_callback(const CallbackMessage& message)
     {
-        auto req = std::make_shared<http::request<http::string_body>>(http::verb::post, request_manager_target, 11);
+        auto req = std::make_shared<http::request<http::string_body>>(http::verb::post, message.target, 11);
         req->set(http::field::host, request_manager_ip);
-        req->set(http::field::content_type, "application/json");
+        req->set(http::field::content_type, message.content_type);
         req->keep_alive(true);
-        req->body() = response_body.dump();
+        req->body() = message.body;
+        auto start_us = Tracer::now_us();
         req->prepare_payload();
 
         SPDLOG_LOGGER_INFO(Logger::instance(), "Sending callback POST to {}:{}", request_manager_ip, request_manager_port);
         http::async_write(callback_stream_, *req,
-            net::bind_executor(callback_strand_, [self = shared_from_this(), req](beast::error_code ec, std::size_t)
+            net::bind_executor(callback_strand_, [self = shared_from_this(), req, trace_id = message.trace_id, start_us](beast::error_code ec, std::size_t)
             {
-                if (ec == beast::http::error::end_of_stream || ec == net::error::eof)
-                {
-                    SPDLOG_LOGGER_WARN(Logger::instance(), "Callback connection closed by server");
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    self->pending_callbacks_.push(json::parse(req->body()));
-                    // self->reconnect_callback_and_write();
-                    return;
-                }
-                if (ec == net::error::connection_reset || ec == net::error::connection_aborted)
-                {
-                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Callback connection error: {}", ec.message());
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    self->pending_callbacks_.push(json::parse(req->body()));
-                    // self->reconnect_callback_and_write();
-                    return;
-                }
                 if (ec)
                 {
-                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Callback async_write failed: {}", ec.message());
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    self->pending_callbacks_.push(json::parse(req->body()));
-                    // self->reconnect_callback_and_write();
+                    self->callback_failed("async_write", ec, true);
                     return;
                 }
                 SPDLOG_LOGGER_INFO(Logger::instance(), "Callback POST sent to {}:{}", request_manager_ip, request_manager_port);
-                self->read_callback();
+                self->read_callback(trace_id, start_us);
             }));
     }
 
-    void read_callback()
+    void read_callback(const std::string& trace_id, std::int64_t start_us)
     {
         auto buffer = std::make_shared<beast::flat_buffer>();
         auto res = std::make_shared<http::response<http::string_body>>();
         http::async_read(callback_stream_, *buffer, *res,
-            net::bind_executor(callback_strand_, [self = shared_from_this(), res, buffer](beast::error_code ec, std::size_t)
+            net::bind_executor(callback_strand_, [self = shared_from_this(), res, buffer, trace_id, start_us](beast::error_code ec, std::size_t)
             {
-                if (ec == beast::http::error::end_of_stream || ec == net::error::eof)
-                {
-                    SPDLOG_LOGGER_WARN(Logger::instance(), "Callback connection closed by server");
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    // if (!self->pending_callbacks_.empty())
-                    //     self->reconnect_callback_and_write();
-                    return;
-                }
-                if (ec == net::error::connection_reset || ec == net::error::connection_aborted)
-                {
-                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Callback connection error: {}", ec.message());
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    // if (!self->pending_callbacks_.empty())
-                    //     self->reconnect_callback_and_write();
-                    return;
-                }
+                tracer.span("callback", trace_id, start_us, Tracer::now_us());
                 if (ec)
                 {
-                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Callback async_read failed: {}", ec.message());
-                    std::string rawData(boost::asio::buffer_cast<const char *>(buffer->data()), boost::asio::buffer_size(buffer->data()));
-                    std::cout << "Raw request: " << rawData << std::endl;
-                    self->callback_connected_ = false;
-                    self->close_callback();
-                    // if (!self->pending_callbacks_.empty())
-                    //     self->reconnect_callback_and_write();
+                    // A kept-alive connection the request manager closed while idle: the result was
+                    // not read, so sending it again is safe. Otherwise it may have been processed.
+                    bool stale = self->callback_reused_ && buffer->size() == 0 &&
+                                 (ec == beast::http::error::end_of_stream || ec == net::error::eof ||
+                                  ec == net::error::connection_reset);
+                    self->callback_failed("async_read", ec, stale);
                     return;
                 }
                 SPDLOG_LOGGER_INFO(Logger::instance(), "Callback response: code = {}, body = {}", res->result_int(), res->body());
@@ -405,13 +2219,8 @@ private:
                     SPDLOG_LOGGER_INFO(Logger::instance(), "Callback connection not kept alive, closing");
                     self->callback_connected_ = false;
                     self->close_callback();
-                    // if (!self->pending_callbacks_.empty())
-                    //     self->reconnect_callback_and_write();
                 }
-                // else
-                // {
-                //     self->pop_callback_response_and_write();
-                // }
+                self->callback_delivered();
             }));
     }
 
@@ -444,33 +2253,171 @@ private:
 class Server
 {
 public:
-    Server(net::io_context& ioc, uint16_t port)
-    : ioc_(ioc), acceptor_(ioc, tcp::endpoint(tcp::v4(), port)), work_(net::make_work_guard(ioc)) {}
+    // Listens on port, or on listen_fd when it took the socket over from a server that drains.
+    Server(net::io_context& ioc, uint16_t port, int listen_fd = -1)
+    : ioc_(ioc), acceptor_(ioc), handoff_acceptor_(ioc), signals_(ioc, SIGINT, SIGTERM), drain_timer_(ioc),
+      work_(net::make_work_guard(ioc)), scheduler_(ioc, listen_fd >= 0), reaper_(scheduler_)
+    {
+        if (listen_fd >= 0)
+            acceptor_.assign(tcp::v4(), listen_fd);
+        else
+        {
+            tcp::endpoint endpoint(tcp::v4(), port);
+            acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(net::socket_base::reuse_address(true));
+            acceptor_.bind(endpoint);
+            acceptor_.listen();
+        }
+        // A leftover socket file of a server that is gone; a live one would hold the port.
+        ::unlink(handoff_socket.c_str());
+        open_handoff();
+    }
+
+    void run()
+    {
+        scheduler_.run();
+        reaper_.run();
+        accept();
+        accept_handoff();
+        wait_signal();
+    }
 
-    void run() { accept(); }
+    // Stops accepting, lets the admitted cases finish and their results be delivered, then stops
+    // the io_context. Thread-safe; only the first call has an effect.
+    void drain(const char* reason)
+    {
+        if (draining_.exchange(true))
+            return;
+        net::post(ioc_, [this, reason]
+        {
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Draining ({}): {} results outstanding", reason, undelivered_results.load());
+            beast::error_code ec;
+            acceptor_.close(ec);
+            close_handoff();
+            scheduler_.drain();
+            check_drained();
+        });
+    }
 
 private:
     net::io_context &ioc_;
     tcp::acceptor acceptor_;
+    net::local::stream_protocol::acceptor handoff_acceptor_;
+    net::signal_set signals_;
+    net::steady_timer drain_timer_;
     net::executor_work_guard<net::io_context::executor_type> work_;
+    TaskScheduler scheduler_;
+    CaseReaper reaper_;
+    std::atomic<bool> draining_{false};
 
     void accept()
     {
         acceptor_.async_accept(
             [this](beast::error_code ec, tcp::socket socket)
             {
+                // A connection accepted as draining began is still answered, with 503 to submissions.
                 if (!ec)
                 {
                     SPDLOG_LOGGER_INFO(Logger::instance(), "Accepted new connection");
-                    std::make_shared<Session>(std::move(socket), ioc_)->run();
+                    std::make_shared<Session>(std::move(socket), ioc_, scheduler_, reaper_,
+                                              [this](const char* reason) { drain(reason); })->run();
                 }
-                else
+                else if (!draining_)
                 {
                     SPDLOG_LOGGER_ERROR(Logger::instance(), "Accept failed: {}", ec.message());
                 }
-                accept();
+                if (!draining_)
+                    accept();
+            });
+    }
+
+    // A server started with --takeover connects here: it is sent the listening socket, and this
+    // one drains. The socket file is removed first, so the successor can bind its own.
+    void open_handoff()
+    {
+        beast::error_code ec;
+        net::local::stream_protocol::endpoint endpoint(handoff_socket.string());
+        handoff_acceptor_.open(endpoint.protocol(), ec);
+        if (!ec)
+            handoff_acceptor_.bind(endpoint, ec);
+        if (!ec)
+            handoff_acceptor_.listen(net::socket_base::max_listen_connections, ec);
+        if (ec)
+        {
+            SPDLOG_LOGGER_WARN(Logger::instance(), "No hand-off socket at {}: {}", handoff_socket.string(), ec.message());
+            handoff_acceptor_.close(ec);
+        }
+    }
+
+    void accept_handoff()
+    {
+        if (!handoff_acceptor_.is_open())
+            return;
+        handoff_acceptor_.async_accept(
+            [this](beast::error_code ec, net::local::stream_protocol::socket peer)
+            {
+                if (ec || draining_)
+                    return;
+                close_handoff();
+                if (!fd_passing::send_fd(peer.native_handle(), acceptor_.native_handle()))
+                {
+                    SPDLOG_LOGGER_ERROR(Logger::instance(), "Handing over the listening socket failed: {}", std::strerror(errno));
+                    open_handoff();
+                    accept_handoff();
+                    return;
+                }
+                SPDLOG_LOGGER_INFO(Logger::instance(), "Listening socket handed over");
+                case_storage->keep_attached(); // the successor uses the same mount
+                drain("taken over");
             });
     }
+
+    void close_handoff()
+    {
+        if (!handoff_acceptor_.is_open())
+            return;
+        beast::error_code ec;
+        handoff_acceptor_.close(ec);
+        ::unlink(handoff_socket.c_str());
+    }
+
+    // The first SIGINT/SIGTERM drains, another one stops at once.
+    void wait_signal()
+    {
+        signals_.async_wait([this](beast::error_code ec, int signal)
+        {
+            if (ec)
+                return;
+            if (draining_)
+            {
+                SPDLOG_LOGGER_WARN(Logger::instance(), "Received signal {} while draining, exiting with {} results outstanding",
+                                   signal, undelivered_results.load());
+                close_handoff();
+                ioc_.stop();
+                return;
+            }
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Received signal {}", signal);
+            drain("signal");
+            wait_signal();
+        });
+    }
+
+    void check_drained()
+    {
+        if (undelivered_results == 0)
+        {
+            SPDLOG_LOGGER_INFO(Logger::instance(), "Drained, exiting");
+            signals_.cancel();
+            ioc_.stop();
+            return;
+        }
+        drain_timer_.expires_after(std::chrono::milliseconds(drain_check_interval_ms));
+        drain_timer_.async_wait([this](beast::error_code ec)
+        {
+            if (!ec)
+                check_drained();
+        });
+    }
 };
 
 int main(int argc, char *argv[])
@@ -480,19 +2427,74 @@ int main(int argc, char *argv[])
     Logger::init(cfg);
     SPDLOG_LOGGER_INFO(Logger::instance(), "Logger Loads Successfully!");
 
-    SPDLOG_LOGGER_INFO(Logger::instance(), "Mount NFS");
-    SPDLOG_LOGGER_INFO(Logger::instance(), mount_nfs_command());
-    int code = safe_system(mount_nfs_command());
-    if (code != 0)
+    std::string capture_path = cli_option(argc, argv, "--capture");
+    if (!capture_path.empty())
+    {
+        if (!capture.open(capture_path, "sim_server"))
+        {
+            SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to open capture file: {}", capture_path);
+            return EXIT_FAILURE;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Capturing inbound requests to {}", capture_path);
+    }
+
+    std::string trace_path = cli_option(argc, argv, "--trace");
+    if (!trace_path.empty())
+    {
+        if (!tracer.open(trace_path, "sim_server"))
+        {
+            SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to open trace file: {}", trace_path);
+            return EXIT_FAILURE;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Writing spans to {}", trace_path);
+    }
+
+    try
+    {
+        zstd_options.level = zstd_level;
+        zstd_options.dictionary = compression::load_dictionary(zstd_dictionary_path);
+    }
+    catch (const std::exception& e)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "{}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::string backend = cli_option(argc, argv, "--storage", storage_backend);
+    case_storage = storage::make(backend, nfs_mnt_dir, mount_nfs_command(), unmount_nfs_command(),
+                                 local_storage_dir, shm_storage_dir);
+    if (!case_storage)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unknown storage backend: {} (nfs, local or shm)", backend);
+        return EXIT_FAILURE;
+    }
+    try
     {
-        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Mount NFS Failed");
+        case_storage->attach();
+    }
+    catch (const std::exception& e)
+    {
+        SPDLOG_LOGGER_CRITICAL(Logger::instance(), "{}", e.what());
         return EXIT_FAILURE;
     }
+    case_root = case_storage->root();
+    SPDLOG_LOGGER_INFO(Logger::instance(), "Case files on {} storage at {}", case_storage->name(), case_root.string());
+
+    // Zero-downtime restart: take the listening socket over from the running server, which drains.
+    int listen_fd = -1;
+    std::string takeover = cli_option(argc, argv, "--takeover");
+    if (!takeover.empty())
+    {
+        listen_fd = fd_passing::receive_fd_from(takeover);
+        if (listen_fd < 0)
+        {
+            SPDLOG_LOGGER_CRITICAL(Logger::instance(), "Unable to take over the listening socket from {}", takeover);
+            return EXIT_FAILURE;
+        }
+        SPDLOG_LOGGER_INFO(Logger::instance(), "Took over the listening socket from {}", takeover);
+    }
 
-    // Registered signal processing
-    std::signal(SIGINT, signal_handler);  // Ctrl+C
-    std::signal(SIGTERM, signal_handler); // Termination signal
-    // Normal registration, exit, and cleanup
+    // Signals drain the server (Server::wait_signal); storage is detached once it has stopped.
     std::atexit(cleanup_on_exit);
 
     try
@@ -500,7 +2502,7 @@ int main(int argc, char *argv[])
         net::io_context ioc;
 
         // Start listening to port
-        auto server = std::make_shared<Server>(ioc, sim_server_port);
+        auto server = std::make_shared<Server>(ioc, sim_server_port, listen_fd);
         server->run();
 
         // TODO: Try 1~3